@@ -0,0 +1,199 @@
+// BarnesHut.cpp
+#include "BarnesHut.hpp"
+#include <cmath>
+
+// Default constructor:
+BarnesHut::BarnesHut()
+{
+    this->theta = BH_THETA;
+}
+
+int BarnesHut::nodeCount() const
+{
+    return int(this->nodes.size());
+}
+
+// --PURPOSE--
+// Rebuild the tree over a new set of bodies.
+// --PARAMETERS--
+// x, y:    Body positions.
+// gm:      GRAVITATIONAL*mass of each body.
+// count:   Number of bodies.
+void BarnesHut::build(const float* x, const float* y, const float* gm,
+                      int count)
+{
+    this->nodes.clear();
+    this->bodyX.assign(x, x+count);
+    this->bodyY.assign(y, y+count);
+    this->bodyGM.assign(gm, gm+count);
+    this->bodyNext.assign(count, -1);
+    if (0 == count) return;
+
+    // Square that bounds every body:
+    float minX = x[0], maxX = x[0];
+    float minY = y[0], maxY = y[0];
+    for (int i = 1; i < count; ++i)
+    {
+        if (x[i] < minX) minX = x[i];
+        if (x[i] > maxX) maxX = x[i];
+        if (y[i] < minY) minY = y[i];
+        if (y[i] > maxY) maxY = y[i];
+    }
+    float half = 0.5f*((maxX-minX > maxY-minY) ? maxX-minX : maxY-minY);
+    newNode(0.5f*(minX+maxX), 0.5f*(minY+maxY), half+1.0f);
+
+    for (int i = 0; i < count; ++i) insert(i);
+    sumMasses();
+}
+
+int BarnesHut::newNode(float cx, float cy, float half)
+{
+    node n;
+    n.cx = cx; n.cy = cy; n.half = half;
+    n.comX = 0.0f; n.comY = 0.0f; n.gm = 0.0f;
+    n.child[0] = n.child[1] = n.child[2] = n.child[3] = -1;
+    n.firstBody = -1;
+    this->nodes.push_back(n);
+    return int(this->nodes.size())-1;
+}
+
+// Push a body down to an empty leaf, splitting occupied leaves on the
+// way. Leaves at BH_MAX_DEPTH keep a list instead of splitting, so
+// bodies at the same spot can't recurse forever.
+void BarnesHut::insert(int body)
+{
+    int n = 0;
+    for (int depth = 0; ; ++depth)
+    {
+        if (-1 == this->nodes[n].child[0])
+        {
+            if (-1 == this->nodes[n].firstBody || depth >= BH_MAX_DEPTH)
+            {
+                this->bodyNext[body] = this->nodes[n].firstBody;
+                this->nodes[n].firstBody = body;
+                return;
+            }
+
+            // Split the leaf and hand its body to the new children:
+            float q = 0.5f*this->nodes[n].half;
+            float cx = this->nodes[n].cx;
+            float cy = this->nodes[n].cy;
+            for (int c = 0; c < 4; ++c)
+            {
+                int child = newNode(cx+((c&1) ? q : -q),
+                                    cy+((c&2) ? q : -q), q);
+                this->nodes[n].child[c] = child;
+            }
+            int old = this->nodes[n].firstBody;
+            this->nodes[n].firstBody = -1;
+            int c = (this->bodyX[old] >= cx ? 1 : 0)
+                  | (this->bodyY[old] >= cy ? 2 : 0);
+            this->nodes[this->nodes[n].child[c]].firstBody = old;
+        }
+
+        // Descend into the quadrant holding the body:
+        int c = (this->bodyX[body] >= this->nodes[n].cx ? 1 : 0)
+              | (this->bodyY[body] >= this->nodes[n].cy ? 2 : 0);
+        n = this->nodes[n].child[c];
+    }
+}
+
+// Children are always created after their parent, so walking the nodes
+// backwards sums each subtree before its parent needs it.
+void BarnesHut::sumMasses()
+{
+    for (int n = int(this->nodes.size())-1; n >= 0; --n)
+    {
+        node& nd = this->nodes[n];
+        float gm = 0.0f, mx = 0.0f, my = 0.0f;
+        if (-1 == nd.child[0])
+        {
+            for (int b = nd.firstBody; -1 != b; b = this->bodyNext[b])
+            {
+                gm += this->bodyGM[b];
+                mx += this->bodyGM[b]*this->bodyX[b];
+                my += this->bodyGM[b]*this->bodyY[b];
+            }
+        }
+        else
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                const node& ch = this->nodes[nd.child[c]];
+                gm += ch.gm;
+                mx += ch.gm*ch.comX;
+                my += ch.gm*ch.comY;
+            }
+        }
+        nd.gm = gm;
+        nd.comX = (0.0f < gm) ? mx/gm : nd.cx;
+        nd.comY = (0.0f < gm) ? my/gm : nd.cy;
+    }
+}
+
+// --PURPOSE--
+// Approximate gravitational acceleration on a set of bullets, laid out
+// the same way as GravityKernel::accumulate.
+// --PARAMETERS--
+// bx, by:  Bullet positions, indexed by slot.
+// index:   The slots to work on.
+// count:   Number of entries in index.
+// ax, ay:  Output, one acceleration per entry of index.
+void BarnesHut::accumulate(const float* bx, const float* by,
+                           const int* index, int count,
+                           float* ax, float* ay) const
+{
+    float sqrTheta = this->theta*this->theta;
+    for (int i = 0; i < count; ++i)
+    {
+        int b = index[i];
+        float sumX = 0.0f;
+        float sumY = 0.0f;
+
+        // Each visited node pushes at most four children:
+        int stack[4*BH_MAX_DEPTH+4];
+        int top = 0;
+        if (!this->nodes.empty()) stack[top++] = 0;
+        while (top > 0)
+        {
+            const node& nd = this->nodes[stack[--top]];
+            if (0.0f >= nd.gm) continue;
+
+            float dx = nd.comX - bx[b];
+            float dy = nd.comY - by[b];
+            float sqrDis = dx*dx + dy*dy;
+            float width = 2.0f*nd.half;
+            bool leaf = (-1 == nd.child[0]);
+
+            if (!leaf && width*width >= sqrTheta*sqrDis)
+            {
+                // Too close to approximate, open the node:
+                for (int c = 0; c < 4; ++c) stack[top++] = nd.child[c];
+                continue;
+            }
+            if (leaf && -1 != this->bodyNext[nd.firstBody])
+            {
+                // Several bodies share this leaf, sum them exactly:
+                for (int o = nd.firstBody; -1 != o; o = this->bodyNext[o])
+                {
+                    float ox = this->bodyX[o] - bx[b];
+                    float oy = this->bodyY[o] - by[b];
+                    float oSqrDis = ox*ox + oy*oy;
+                    if (0.0f >= oSqrDis) continue;
+                    float fg = this->bodyGM[o]/(oSqrDis*sqrtf(oSqrDis));
+                    sumX += fg*ox;
+                    sumY += fg*oy;
+                }
+                continue;
+            }
+
+            // A body doesn't pull on itself:
+            if (0.0f >= sqrDis) continue;
+            float fg = nd.gm/(sqrDis*sqrtf(sqrDis));
+            sumX += fg*dx;
+            sumY += fg*dy;
+        }
+        ax[i] = sumX;
+        ay[i] = sumY;
+    }
+}
@@ -0,0 +1,49 @@
+// BarnesHut.hpp
+#ifndef BARNESHUT_HPP_
+#define BARNESHUT_HPP_
+#include <vector>
+#include "constants.hpp"
+
+//-----------------//
+// Barnes-Hut Tree //
+//-----------------//
+// Quadtree over a set of gravitating bodies. Distant groups of bodies
+// are approximated by their combined mass at their center of mass,
+// which turns the O(bullets x bodies) direct sum into roughly
+// O(bullets x log(bodies)). GravityKernel remains the exact reference.
+class BarnesHut
+{
+public:
+    BarnesHut();
+    void build(const float* x, const float* y, const float* gm,
+               int count);
+    void accumulate(const float* bx, const float* by,
+                    const int* index, int count,
+                    float* ax, float* ay) const;
+    int nodeCount() const;
+
+    // Opening angle: a node of width w at distance d is treated as a
+    // single body when w/d < theta. 0 gives the exact sum.
+    float theta;
+private:
+    struct node
+    {
+        float cx, cy, half;     // square bounds
+        float comX, comY;       // center of mass
+        float gm;               // GRAVITATIONAL*mass of everything below
+        int child[4];           // -1 for a leaf
+        int firstBody;          // leaf bodies, linked through bodyNext
+    };
+
+    int newNode(float cx, float cy, float half);
+    void insert(int body);
+    void sumMasses();
+
+    std::vector<node> nodes;
+    std::vector<float> bodyX;
+    std::vector<float> bodyY;
+    std::vector<float> bodyGM;
+    std::vector<int> bodyNext;
+};
+
+#endif
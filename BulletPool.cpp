@@ -0,0 +1,113 @@
+// BulletPool.cpp
+#include "BulletPool.hpp"
+
+// --PURPOSE--
+// Set up an empty pool.
+// --PARAMETERS--
+// icapacity:       Bullets that fit before the pool has to grow.
+// imaxCapacity:    Most bullets the pool may ever hold, 0 for no limit.
+BulletPool::BulletPool(int icapacity, int imaxCapacity)
+    : slots(icapacity, imaxCapacity)
+{
+    this->resize(this->slots.capacity());
+}
+
+// Remove every bullet from the pool:
+void BulletPool::clear()
+{
+    this->slots.clear();
+}
+
+// Make room for at least ncapacity bullets without growing again:
+void BulletPool::reserve(int ncapacity)
+{
+    this->slots.reserve(ncapacity);
+    this->resize(this->slots.capacity());
+}
+
+// Size the attribute arrays to match the slots:
+void BulletPool::resize(int ncapacity)
+{
+    this->posX.resize(ncapacity, 0.0f);
+    this->posY.resize(ncapacity, 0.0f);
+    this->velX.resize(ncapacity, 0.0f);
+    this->velY.resize(ncapacity, 0.0f);
+    this->rad.resize(ncapacity, 0.0f);
+    this->mass.resize(ncapacity, 0.0f);
+    this->startTime.resize(ncapacity, 0.0f);
+    this->color.resize(ncapacity, glm::vec3(1.0f));
+}
+
+// --PURPOSE--
+// Place a bullet in a free slot, growing the pool if none are left.
+// --RETURNS--
+// A handle to the bullet, with slot -1 if the pool is full and may not
+// grow any further.
+handle BulletPool::add(glm::vec2 ipos, glm::vec2 ivel, float irad,
+                       float imass, float istartTime)
+{
+    if (!this->slots.hasFree() && this->slots.grow())
+        this->resize(this->slots.capacity());
+
+    handle h = this->slots.allocate();
+    int slot = h.slot;
+    if (-1 == slot) return h;
+
+    this->posX[slot] = ipos[0];
+    this->posY[slot] = ipos[1];
+    this->velX[slot] = ivel[0];
+    this->velY[slot] = ivel[1];
+    this->rad[slot] = irad;
+    this->mass[slot] = imass;
+    this->startTime[slot] = istartTime;
+    this->color[slot] = glm::vec3(1.0f);
+    return h;
+}
+
+// --PURPOSE--
+// Return a bullet's slot to the pool. The last live slot is swapped
+// into its place in the active list, so callers walking the active list
+// while killing bullets should walk it backwards.
+void BulletPool::kill(int slot)
+{
+    if (!this->slots.release(slot)) return;
+
+    this->velX[slot] = 0.0f;
+    this->velY[slot] = 0.0f;
+    this->rad[slot] = 0.0f;
+}
+
+// Kill a bullet by handle. Fails if the bullet has already died:
+bool BulletPool::release(handle h)
+{
+    if (!this->slots.isValid(h)) return false;
+    this->kill(h.slot);
+    return true;
+}
+
+bool BulletPool::isAlive(int slot) const
+{
+    return this->slots.isAlive(slot);
+}
+
+bool BulletPool::isAlive(handle h) const
+{
+    return this->slots.isValid(h);
+}
+
+int BulletPool::count() const
+{
+    return this->slots.count();
+}
+
+int BulletPool::capacity() const
+{
+    return this->slots.capacity();
+}
+
+// Compacted list of live slots, valid for [0, count()) until the next
+// add or kill:
+const int* BulletPool::active() const
+{
+    return this->slots.active();
+}
@@ -0,0 +1,47 @@
+// BulletPool.hpp
+#ifndef BULLETPOOL_HPP_
+#define BULLETPOOL_HPP_
+#include <vector>
+#include <glm/glm.hpp>
+#include "constants.hpp"
+#include "HandlePool.hpp"
+
+//-------------------//
+// Bullet Pool Class //
+//-------------------//
+// Bullets are stored as a structure of arrays indexed by slot. The
+// slots that are alive and in flight are kept in a compacted list so
+// the physics and draw loops never touch dead slots. Dead slots go back
+// on a free list, and the arrays grow when the free list runs dry.
+class BulletPool
+{
+public:
+    BulletPool(int icapacity = BULLET_CAPACITY, int imaxCapacity = 0);
+    void clear();
+    void reserve(int ncapacity);
+    handle add(glm::vec2 ipos, glm::vec2 ivel, float irad, float imass,
+               float istartTime);
+    void kill(int slot);
+    bool release(handle h);
+    bool isAlive(int slot) const;
+    bool isAlive(handle h) const;
+    int count() const;
+    int capacity() const;
+    const int* active() const;
+
+    // Per-slot attributes, capacity() long:
+    std::vector<float> posX;
+    std::vector<float> posY;
+    std::vector<float> velX;
+    std::vector<float> velY;
+    std::vector<float> rad;
+    std::vector<float> mass;
+    std::vector<float> startTime;
+    std::vector<glm::vec3> color;
+private:
+    void resize(int ncapacity);
+
+    HandlePool slots;
+};
+
+#endif
@@ -1,183 +1,876 @@
 //CollisionDetector.cpp
 #include "CollisionDetector.hpp"
+#include "GravityKernel.hpp"
+#include "DebugDraw.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COLLISION_X86
+#include <immintrin.h>
+#endif
 
 // Check for a collision between a planet and bullet type object.
 //just this line
 
 bool CollisionDetector::checkCollision(const planet &p, const bullet &b)
 {
-    bool collision = false;
+    return checkCollision(p, b.rad, b.pos);
+}
+
+// Same check for a bullet given only by its radius and position, as
+// stored in the BulletPool. Makes no GL calls, so it is safe to run
+// from worker threads.
+bool CollisionDetector::checkCollision(const planet &p, float rad,
+                                       const glm::vec2& pos)
+{
+    return 0 != collide(p, rad, pos, NULL, 0);
+}
+
+// --PURPOSE--
+// Collect the triangles of the planet that a bullet overlaps, e.g. to
+// visualize a hit. Like checkCollision, this makes no GL calls.
+// --PARAMETERS--
+// tris:     Output, 6 floats (three points) per overlapped triangle.
+// maxTris:  Number of triangles tris has room for.
+// --RETURNS--
+// The number of triangles written, or -1 if the core was hit.
+int CollisionDetector::getHitTriangles(const planet &p, float rad,
+                                       const glm::vec2& pos,
+                                       float* tris, int maxTris)
+{
+    return collide(p, rad, pos, tris, maxTris);
+}
 
-    int size = 0;
-    GLfloat* triangles = getTriangleList(p, b, &size);
-    if (-1 == size)
+// --PURPOSE--
+// Rule out, for a batch of bullets at once, the ones whose step can't
+// touch a planet, e.g. every bullet the grid put near it. Each bullet
+// sweeps a capsule, its circle moved along a straight line, and that is
+// tested exactly against the outline cached by
+// planet::updateWorldGeometry(): the capsule touches the planet when the
+// start is inside it, or when the path comes within the radius of an
+// edge. Several bullets share each vector instruction, on the same
+// scalar/SSE4/AVX2 path as GravityKernel. The bullets are grown by
+// SWEEP_FILTER_SLACK, so rounding never rules out one that sweepCollision
+// would find touching. Use sweepCollision on the rest for where.
+// --PARAMETERS--
+// x0, y0:      Bullet positions at the start of the step, by slot.
+// x1, y1:      And at the end.
+// rad:         Bullet radii, by slot.
+// index:       The slots to test.
+// count:       Number of entries in index.
+// mask:        Output, (count+31)/32 words. Bit i%32 of word i/32 is set
+//              when the bullet at index[i] may touch the planet.
+// --RETURNS--
+// The number of bullets that may touch the planet.
+int CollisionDetector::sweepCollisions(const planet& p, const float* x0,
+                                       const float* y0, const float* x1,
+                                       const float* y1, const float* rad,
+                                       const int* index, int count,
+                                       unsigned* mask)
+{
+    for (int w = 0; w < (count+31)/32; ++w) mask[w] = 0;
+    if (NULL == p.getPlanetData() || 0 >= count) return 0;
+
+    // Everything about an edge that doesn't depend on the bullet:
+    float edges[OUTLINE_EDGE_FLOATS*NUM_PLANET_VERTS];
+    const float* world = p.getWorldData();
+    for (int v = 0; v < NUM_PLANET_VERTS; ++v)
     {
-        // core was hit
-        fprintf(stdout, "!!!CORE HIT!!!\n");
+        float* e = edges+OUTLINE_EDGE_FLOATS*v;
+        float dx = world[2*v+4]-world[2*v+2];
+        float dy = world[2*v+5]-world[2*v+3];
+        float ee = dx*dx+dy*dy;
+        e[0] = world[2*v+2];
+        e[1] = world[2*v+3];
+        e[2] = dx;
+        e[3] = dy;
+        e[4] = (ee > TOL) ? 1.0f/ee : 0.0f;
+        e[5] = (0.0f != dy) ? dx/dy : 0.0f;
+    }
+
+    const float* ends[4] = {x0, y0, x1, y1};
+    switch (GravityKernel::getPath())
+    {
+        case GRAVITY_AVX2:
+            batchAVX2(p, edges, ends, rad, index, count, mask);
+            break;
+        case GRAVITY_SSE4:
+            batchSSE4(p, edges, ends, rad, index, count, mask);
+            break;
+        default:
+            batchScalar(p, edges, ends, rad, index, 0, count, mask);
+            break;
+    }
+
+    int hits = 0;
+    for (int w = 0; w < (count+31)/32; ++w)
+        hits += __builtin_popcount(mask[w]);
+    return hits;
+}
+
+// Reference implementation of sweepCollisions, also used for the
+// remainder of the vector paths. Works on index[first] through
+// index[count-1]. ends holds x0, y0, x1 and y1.
+void CollisionDetector::batchScalar(const planet& p, const float* edges,
+                                    const float* const* ends,
+                                    const float* rad, const int* index,
+                                    int first, int count, unsigned* mask)
+{
+    for (int i = first; i < count; ++i)
+    {
+        int b = index[i];
+        float ax = ends[0][b];
+        float ay = ends[1][b];
+        float dx = ends[2][b]-ax;
+        float dy = ends[3][b]-ay;
+        float dd = dx*dx+dy*dy;
+        float invDD = (dd > TOL) ? 1.0f/dd : 0.0f;
+        float r = rad[b]+SWEEP_FILTER_SLACK;
+        float r2 = r*r;
+
+        // Out of reach of every edge all along the path?
+        float cx = ax-p.pos[0];
+        float cy = ay-p.pos[1];
+        float tc = -(cx*dx+cy*dy)*invDD;
+        tc = (tc < 0.0f) ? 0.0f : (tc > 1.0f) ? 1.0f : tc;
+        cx += tc*dx;
+        cy += tc*dy;
+        float reach = p.maxRad+r;
+        if (cx*cx+cy*cy > reach*reach) continue;
+
+        bool touch = false;
+        bool inside = false;
+        for (int v = 0; v < NUM_PLANET_VERTS; ++v)
+        {
+            const float* e = edges+OUTLINE_EDGE_FLOATS*v;
+            float mx = ax-e[0];
+            float my = ay-e[1];
+
+            // The start, then the end, against the edge:
+            float t = (mx*e[2]+my*e[3])*e[4];
+            t = (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+            float ox = mx-t*e[2];
+            float oy = my-t*e[3];
+            touch = touch || (ox*ox+oy*oy <= r2);
+            float nx = mx+dx;
+            float ny = my+dy;
+            t = (nx*e[2]+ny*e[3])*e[4];
+            t = (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+            ox = nx-t*e[2];
+            oy = ny-t*e[3];
+            touch = touch || (ox*ox+oy*oy <= r2);
+
+            // The edge's first vertex against the path. Its second is
+            // the next edge's first:
+            t = -(mx*dx+my*dy)*invDD;
+            t = (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+            ox = mx+t*dx;
+            oy = my+t*dy;
+            touch = touch || (ox*ox+oy*oy <= r2);
+
+            // The path crossing the edge:
+            float c0 = dy*mx-dx*my;
+            float c1 = c0+dx*e[3]-dy*e[2];
+            float c2 = e[2]*my-e[3]*mx;
+            float c3 = c2+e[2]*dy-e[3]*dx;
+            touch = touch || (c0*c1 < 0.0f && c2*c3 < 0.0f);
+
+            // Crossing count for the start:
+            if ((e[1] > ay) != (e[1]+e[3] > ay) && ax < e[0]+my*e[5])
+                inside = !inside;
+        }
+        if (touch || inside) mask[i/32] |= 1u << (i%32);
+    }
+}
+
+#ifdef COLLISION_X86
+__attribute__((target("sse4.1")))
+void CollisionDetector::batchSSE4(const planet& p, const float* edges,
+                                  const float* const* ends,
+                                  const float* rad, const int* index,
+                                  int count, unsigned* mask)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 tol = _mm_set1_ps(float(TOL));
+    const __m128 slack = _mm_set1_ps(SWEEP_FILTER_SLACK);
+    const __m128 px = _mm_set1_ps(p.pos[0]);
+    const __m128 py = _mm_set1_ps(p.pos[1]);
+    const __m128 maxRad = _mm_set1_ps(p.maxRad);
+    const float* x0 = ends[0];
+    const float* y0 = ends[1];
+    const float* x1 = ends[2];
+    const float* y1 = ends[3];
+    int i = 0;
+    for (; i+4 <= count; i += 4)
+    {
+        const int* idx = index+i;
+        __m128 ax = _mm_set_ps(x0[idx[3]], x0[idx[2]], x0[idx[1]], x0[idx[0]]);
+        __m128 ay = _mm_set_ps(y0[idx[3]], y0[idx[2]], y0[idx[1]], y0[idx[0]]);
+        __m128 dx = _mm_sub_ps(
+            _mm_set_ps(x1[idx[3]], x1[idx[2]], x1[idx[1]], x1[idx[0]]), ax);
+        __m128 dy = _mm_sub_ps(
+            _mm_set_ps(y1[idx[3]], y1[idx[2]], y1[idx[1]], y1[idx[0]]), ay);
+        __m128 dd = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 invDD = _mm_and_ps(_mm_cmpgt_ps(dd, tol),
+                                  _mm_div_ps(one, dd));
+        __m128 r = _mm_add_ps(_mm_set_ps(rad[idx[3]], rad[idx[2]],
+                                         rad[idx[1]], rad[idx[0]]), slack);
+        __m128 r2 = _mm_mul_ps(r, r);
+
+        // Skip the edges when the whole group is out of reach:
+        __m128 cx = _mm_sub_ps(ax, px);
+        __m128 cy = _mm_sub_ps(ay, py);
+        __m128 tc = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, dx),
+                                          _mm_mul_ps(cy, dy)), invDD);
+        tc = _mm_min_ps(_mm_max_ps(_mm_sub_ps(zero, tc), zero), one);
+        cx = _mm_add_ps(cx, _mm_mul_ps(tc, dx));
+        cy = _mm_add_ps(cy, _mm_mul_ps(tc, dy));
+        __m128 reach = _mm_add_ps(maxRad, r);
+        __m128 near = _mm_cmple_ps(
+            _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)),
+            _mm_mul_ps(reach, reach));
+        if (0 == _mm_movemask_ps(near)) continue;
+
+        __m128 touch = zero;
+        __m128 inside = zero;
+        for (int v = 0; v < NUM_PLANET_VERTS; ++v)
+        {
+            const float* e = edges+OUTLINE_EDGE_FLOATS*v;
+            __m128 ex = _mm_set1_ps(e[2]);
+            __m128 ey = _mm_set1_ps(e[3]);
+            __m128 e0y = _mm_set1_ps(e[1]);
+            __m128 inv = _mm_set1_ps(e[4]);
+            __m128 mx = _mm_sub_ps(ax, _mm_set1_ps(e[0]));
+            __m128 my = _mm_sub_ps(ay, e0y);
+
+            // The start, then the end, against the edge:
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(mx, ex),
+                                             _mm_mul_ps(my, ey)), inv);
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            __m128 ox = _mm_sub_ps(mx, _mm_mul_ps(t, ex));
+            __m128 oy = _mm_sub_ps(my, _mm_mul_ps(t, ey));
+            touch = _mm_or_ps(touch, _mm_cmple_ps(
+                _mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)), r2));
+            __m128 nx = _mm_add_ps(mx, dx);
+            __m128 ny = _mm_add_ps(my, dy);
+            t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(nx, ex),
+                                      _mm_mul_ps(ny, ey)), inv);
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            ox = _mm_sub_ps(nx, _mm_mul_ps(t, ex));
+            oy = _mm_sub_ps(ny, _mm_mul_ps(t, ey));
+            touch = _mm_or_ps(touch, _mm_cmple_ps(
+                _mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)), r2));
+
+            // The edge's first vertex against the path:
+            t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(mx, dx),
+                                      _mm_mul_ps(my, dy)), invDD);
+            t = _mm_min_ps(_mm_max_ps(_mm_sub_ps(zero, t), zero), one);
+            ox = _mm_add_ps(mx, _mm_mul_ps(t, dx));
+            oy = _mm_add_ps(my, _mm_mul_ps(t, dy));
+            touch = _mm_or_ps(touch, _mm_cmple_ps(
+                _mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)), r2));
+
+            // The path crossing the edge:
+            __m128 c0 = _mm_sub_ps(_mm_mul_ps(dy, mx), _mm_mul_ps(dx, my));
+            __m128 c1 = _mm_add_ps(c0, _mm_sub_ps(_mm_mul_ps(dx, ey),
+                                                  _mm_mul_ps(dy, ex)));
+            __m128 c2 = _mm_sub_ps(_mm_mul_ps(ex, my), _mm_mul_ps(ey, mx));
+            __m128 c3 = _mm_add_ps(c2, _mm_sub_ps(_mm_mul_ps(ex, dy),
+                                                  _mm_mul_ps(ey, dx)));
+            touch = _mm_or_ps(touch, _mm_and_ps(
+                _mm_cmplt_ps(_mm_mul_ps(c0, c1), zero),
+                _mm_cmplt_ps(_mm_mul_ps(c2, c3), zero)));
+
+            // Crossing count for the start:
+            __m128 cross = _mm_xor_ps(_mm_cmpgt_ps(e0y, ay),
+                                      _mm_cmpgt_ps(_mm_add_ps(e0y, ey), ay));
+            __m128 left = _mm_cmplt_ps(mx, _mm_mul_ps(my, _mm_set1_ps(e[5])));
+            inside = _mm_xor_ps(inside, _mm_and_ps(cross, left));
+        }
+        unsigned bits = _mm_movemask_ps(
+            _mm_and_ps(near, _mm_or_ps(touch, inside)));
+        mask[i/32] |= bits << (i%32);
+    }
+    batchScalar(p, edges, ends, rad, index, i, count, mask);
+}
+
+__attribute__((target("avx2")))
+void CollisionDetector::batchAVX2(const planet& p, const float* edges,
+                                  const float* const* ends,
+                                  const float* rad, const int* index,
+                                  int count, unsigned* mask)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 tol = _mm256_set1_ps(float(TOL));
+    const __m256 slack = _mm256_set1_ps(SWEEP_FILTER_SLACK);
+    const __m256 px = _mm256_set1_ps(p.pos[0]);
+    const __m256 py = _mm256_set1_ps(p.pos[1]);
+    const __m256 maxRad = _mm256_set1_ps(p.maxRad);
+    int i = 0;
+    for (; i+8 <= count; i += 8)
+    {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(index+i));
+        __m256 ax = _mm256_i32gather_ps(ends[0], idx, 4);
+        __m256 ay = _mm256_i32gather_ps(ends[1], idx, 4);
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(ends[2], idx, 4), ax);
+        __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(ends[3], idx, 4), ay);
+        __m256 dd = _mm256_add_ps(_mm256_mul_ps(dx, dx),
+                                  _mm256_mul_ps(dy, dy));
+        __m256 invDD = _mm256_and_ps(_mm256_cmp_ps(dd, tol, _CMP_GT_OQ),
+                                     _mm256_div_ps(one, dd));
+        __m256 r = _mm256_add_ps(_mm256_i32gather_ps(rad, idx, 4), slack);
+        __m256 r2 = _mm256_mul_ps(r, r);
+
+        // Skip the edges when the whole group is out of reach:
+        __m256 cx = _mm256_sub_ps(ax, px);
+        __m256 cy = _mm256_sub_ps(ay, py);
+        __m256 tc = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cx, dx),
+                                                _mm256_mul_ps(cy, dy)),
+                                  invDD);
+        tc = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(zero, tc), zero),
+                           one);
+        cx = _mm256_add_ps(cx, _mm256_mul_ps(tc, dx));
+        cy = _mm256_add_ps(cy, _mm256_mul_ps(tc, dy));
+        __m256 reach = _mm256_add_ps(maxRad, r);
+        __m256 near = _mm256_cmp_ps(
+            _mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)),
+            _mm256_mul_ps(reach, reach), _CMP_LE_OQ);
+        if (0 == _mm256_movemask_ps(near)) continue;
+
+        __m256 touch = zero;
+        __m256 inside = zero;
+        for (int v = 0; v < NUM_PLANET_VERTS; ++v)
+        {
+            const float* e = edges+OUTLINE_EDGE_FLOATS*v;
+            __m256 ex = _mm256_set1_ps(e[2]);
+            __m256 ey = _mm256_set1_ps(e[3]);
+            __m256 e0y = _mm256_set1_ps(e[1]);
+            __m256 inv = _mm256_set1_ps(e[4]);
+            __m256 mx = _mm256_sub_ps(ax, _mm256_set1_ps(e[0]));
+            __m256 my = _mm256_sub_ps(ay, e0y);
+
+            // The start, then the end, against the edge:
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(mx, ex),
+                                                   _mm256_mul_ps(my, ey)),
+                                     inv);
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+            __m256 ox = _mm256_sub_ps(mx, _mm256_mul_ps(t, ex));
+            __m256 oy = _mm256_sub_ps(my, _mm256_mul_ps(t, ey));
+            touch = _mm256_or_ps(touch, _mm256_cmp_ps(
+                _mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)),
+                r2, _CMP_LE_OQ));
+            __m256 nx = _mm256_add_ps(mx, dx);
+            __m256 ny = _mm256_add_ps(my, dy);
+            t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(nx, ex),
+                                            _mm256_mul_ps(ny, ey)), inv);
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+            ox = _mm256_sub_ps(nx, _mm256_mul_ps(t, ex));
+            oy = _mm256_sub_ps(ny, _mm256_mul_ps(t, ey));
+            touch = _mm256_or_ps(touch, _mm256_cmp_ps(
+                _mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)),
+                r2, _CMP_LE_OQ));
+
+            // The edge's first vertex against the path:
+            t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(mx, dx),
+                                            _mm256_mul_ps(my, dy)), invDD);
+            t = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(zero, t), zero),
+                              one);
+            ox = _mm256_add_ps(mx, _mm256_mul_ps(t, dx));
+            oy = _mm256_add_ps(my, _mm256_mul_ps(t, dy));
+            touch = _mm256_or_ps(touch, _mm256_cmp_ps(
+                _mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)),
+                r2, _CMP_LE_OQ));
+
+            // The path crossing the edge:
+            __m256 c0 = _mm256_sub_ps(_mm256_mul_ps(dy, mx),
+                                      _mm256_mul_ps(dx, my));
+            __m256 c1 = _mm256_add_ps(c0, _mm256_sub_ps(
+                _mm256_mul_ps(dx, ey), _mm256_mul_ps(dy, ex)));
+            __m256 c2 = _mm256_sub_ps(_mm256_mul_ps(ex, my),
+                                      _mm256_mul_ps(ey, mx));
+            __m256 c3 = _mm256_add_ps(c2, _mm256_sub_ps(
+                _mm256_mul_ps(ex, dy), _mm256_mul_ps(ey, dx)));
+            touch = _mm256_or_ps(touch, _mm256_and_ps(
+                _mm256_cmp_ps(_mm256_mul_ps(c0, c1), zero, _CMP_LT_OQ),
+                _mm256_cmp_ps(_mm256_mul_ps(c2, c3), zero, _CMP_LT_OQ)));
+
+            // Crossing count for the start:
+            __m256 cross = _mm256_xor_ps(
+                _mm256_cmp_ps(e0y, ay, _CMP_GT_OQ),
+                _mm256_cmp_ps(_mm256_add_ps(e0y, ey), ay, _CMP_GT_OQ));
+            __m256 left = _mm256_cmp_ps(
+                mx, _mm256_mul_ps(my, _mm256_set1_ps(e[5])), _CMP_LT_OQ);
+            inside = _mm256_xor_ps(inside, _mm256_and_ps(cross, left));
+        }
+        unsigned bits = _mm256_movemask_ps(
+            _mm256_and_ps(near, _mm256_or_ps(touch, inside)));
+        mask[i/32] |= bits << (i%32);
+    }
+    batchScalar(p, edges, ends, rad, index, i, count, mask);
+}
+#else
+// Without x86 vector units both paths are the scalar loop:
+void CollisionDetector::batchSSE4(const planet& p, const float* edges,
+                                  const float* const* ends,
+                                  const float* rad, const int* index,
+                                  int count, unsigned* mask)
+{
+    batchScalar(p, edges, ends, rad, index, 0, count, mask);
+}
+
+void CollisionDetector::batchAVX2(const planet& p, const float* edges,
+                                  const float* const* ends,
+                                  const float* rad, const int* index,
+                                  int count, unsigned* mask)
+{
+    batchScalar(p, edges, ends, rad, index, 0, count, mask);
+}
+#endif
+
+// --PURPOSE--
+// Find the first contact between a planet and a bullet moving in a
+// straight line, so fast bullets can't tunnel through the surface
+// between steps. The planet is held still in its current orientation.
+// --PARAMETERS--
+// rad:     The radius of the bullet.
+// p0, p1:  The bullet's position at the start and end of the move.
+// toi:     Output, the fraction of the move at first contact, in [0, 1].
+// spin:    Extra rotation on top of the planet's orientation, to test
+//          against the planet as it will be later.
+// --RETURNS--
+// true if the bullet touches the planet at any point of the move.
+bool CollisionDetector::sweepCollision(const planet& pl, float rad,
+                                       const glm::vec2& p0,
+                                       const glm::vec2& p1, float* toi,
+                                       float spin)
+{
+    using namespace glm;
+
+    const float* outline = pl.getPlanetData();
+    vec2 q0, q1;
+    if (NULL == outline || !toPlanetFrame(pl, rad, p0, p1, spin, &q0, &q1))
+        return false;
+    vec2 d = q1-q0;
+    float dd = dot(d, d);
+
+    // Touching before it even moves?
+    if (outlineCircleCheck(outline, rad, q0))
+    {
+        *toi = 0.0f;
         return true;
     }
-    else if (NULL == triangles) return collision;
+    if (dd <= TOL) return false;
 
-    // Determine the number of triangles from size:
-    int tCount = size/2-2;
-    for (int i = 0; i < tCount; ++i)
+    // Starting outside, the bullet must first touch an edge or a vertex.
+    // Each edge grown by the bullet radius is a capsule: two disks and a
+    // band. The earliest entry into any of them is the contact.
+    float first = 2.0f;
+    for (int v = 0; v < NUM_PLANET_VERTS; ++v)
     {
-        GLfloat tri[6] = {
-            triangles[0],     triangles[1],
-            triangles[2*i+2], triangles[2*i+3],
-            triangles[2*i+4], triangles[2*i+5]
-        };
-
-        // If the bullet intersects a triangle, draw the triangle.
-        if (polyCircleCheck(tri, 3, b.rad, b.pos))
+        vec2 e0 = vec2(outline[2*v+2], outline[2*v+3]);
+        vec2 e1 = vec2(outline[2*v+4], outline[2*v+5]);
+        vec2 m = q0-e0;
+
+        // Disk around e0, e1 is covered by the next edge:
+        float b = dot(m, d);
+        float disc = b*b-dd*(dot(m, m)-rad*rad);
+        if (disc >= 0.0f)
         {
+            float tv = (-b-sqrt(disc))/dd;
+            if (tv >= 0.0f && tv < first) first = tv;
+        }
+
+        // Band along the edge, entered from the side the bullet is on:
+        vec2 edge = e1-e0;
+        float len = length(edge);
+        if (len <= TOL) continue;
+        vec2 n = vec2(edge[1], -edge[0])/len;
+        float s0 = dot(m, n);
+        float dn = dot(d, n);
+        if (absf(s0) < rad || absf(dn) <= TOL) continue;
+        float te = (((s0 > 0.0f) ? rad : -rad)-s0)/dn;
+        if (te < 0.0f || te >= first) continue;
+        float along = dot(m+te*d, edge)/len;
+        if (along >= 0.0f && along <= len) first = te;
+    }
+
+    if (first > 1.0f) return false;
+    *toi = first;
+    return true;
+}
+
+// --PURPOSE--
+// Move a bullet's path into the planet's frame, where the outline and
+// its distance field are stored unrotated.
+// --PARAMETERS--
+// spin:    Extra rotation on top of the planet's orientation.
+// q0, q1:  Output, the ends of the path relative to the planet.
+// --RETURNS--
+// false if the path never comes within reach of the planet, in which
+// case q0 and q1 are left alone.
+bool CollisionDetector::toPlanetFrame(const planet& pl, float rad,
+                                      const glm::vec2& p0,
+                                      const glm::vec2& p1, float spin,
+                                      glm::vec2* q0, glm::vec2* q1)
+{
+    using namespace glm;
+
+    // Closest approach of the path to the center, before any trig:
+    vec2 a0 = p0-pl.pos;
+    vec2 a1 = p1-pl.pos;
+    vec2 a = a1-a0;
+    float dd = dot(a, a);
+    float t = (dd > TOL) ? -dot(a0, a)/dd : 0.0f;
+    t = (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+    vec2 closest = a0+t*a;
+    float reach = pl.maxRad+rad;
+    if (dot(closest, closest) > reach*reach) return false;
+
+    float c = pl.orientCos;
+    float s = pl.orientSin;
+    if (0.0f != spin)
+    {
+        c = cos(pl.orient+spin);
+        s = sin(pl.orient+spin);
+    }
+    *q0 = vec2(c*a0[0]+s*a0[1], c*a0[1]-s*a0[0]);
+    *q1 = vec2(c*a1[0]+s*a1[1], c*a1[1]-s*a1[0]);
+    return true;
+}
+
+// --PURPOSE--
+// Whether a bullet overlaps a planet, from the planet's distance field.
+// Constant time, and within about a field cell of the exact outline.
+bool CollisionDetector::checkDistanceField(const planet& pl, float rad,
+                                           const glm::vec2& pos)
+{
+    const DistanceField& field = pl.getDistanceField();
+    if (field.empty()) return false;
+
+    glm::vec2 p = pos-pl.pos;
+    float c = pl.orientCos;
+    float s = pl.orientSin;
+    return field.distance(c*p[0]+s*p[1], c*p[1]-s*p[0]) <= rad;
+}
+
+// --PURPOSE--
+// sweepCollision answered from the planet's distance field: the bullet
+// is sphere traced along its path, each move as long as the field's
+// clearance, so it never passes the surface. Once within a sampling
+// error of it, or still grazing it after SDF_MAX_MARCH moves, the exact
+// sweep takes the rest of the path. Paths that stay clear of the
+// planet, most of them, never touch the outline.
+// --PARAMETERS--
+// See sweepCollision.
+// --RETURNS--
+// true if the bullet touches the planet at any point of the move.
+bool CollisionDetector::sweepDistanceField(const planet& pl, float rad,
+                                           const glm::vec2& p0,
+                                           const glm::vec2& p1,
+                                           float* toi, float spin)
+{
+    using namespace glm;
+
+    const DistanceField& field = pl.getDistanceField();
+    vec2 q0, q1;
+    if (field.empty() || !toPlanetFrame(pl, rad, p0, p1, spin, &q0, &q1))
+        return false;
+
+    vec2 d = q1-q0;
+    float len = length(d);
+    float t = 0.0f;
+    for (int m = 0; m < SDF_MAX_MARCH; ++m)
+    {
+        vec2 q = q0+t*d;
+        float clear = field.clearance(q[0], q[1])-rad;
+        if (clear <= 0.0f) break;
+        if (len <= TOL) return false;
+        t += clear/len;
+        if (t > 1.0f) return false;
+    }
+    if (!sweepCollision(pl, rad, p0+t*(p1-p0), p1, toi, spin)) return false;
+    *toi = t+(1.0f-t)*(*toi);
+    return true;
+}
+
+// --PURPOSE--
+// Outward surface normal of a planet near a point, e.g. where a bullet
+// landed, from the gradient of the distance field.
+// --RETURNS--
+// A unit vector in world space.
+glm::vec2 CollisionDetector::surfaceNormal(const planet& pl,
+                                           const glm::vec2& pos)
+{
+    using glm::vec2;
+
+    vec2 p = pos-pl.pos;
+    float c = pl.orientCos;
+    float s = pl.orientSin;
+    vec2 n = pl.getDistanceField().normal(c*p[0]+s*p[1], c*p[1]-s*p[0]);
+    return vec2(c*n[0]-s*n[1], s*n[0]+c*n[1]);
+}
+
+// --PURPOSE--
+// Record where a bullet landed for debug drawing: the planet triangles
+// it overlaps in red with white edges, and the surface normal. Does
+// nothing unless DebugDraw is enabled.
+// --PARAMETERS--
+// normal:  Outward surface normal at pos, e.g. from surfaceNormal.
+void CollisionDetector::recordContact(const planet& pl, float rad,
+                                      const glm::vec2& pos,
+                                      const glm::vec2& normal)
+{
+    using glm::vec2;
+    using glm::vec4;
+    if (!DebugDraw::enabled()) return;
+
+    float tris[6*NUM_PLANET_VERTS];
+    int tCount = collide(pl, rad, pos, tris, NUM_PLANET_VERTS);
+    for (int t = 0; t < tCount; ++t)
+    {
+        const float* tri = tris+6*t;
+        vec2 p0 = vec2(tri[0], tri[1]);
+        vec2 p1 = vec2(tri[2], tri[3]);
+        vec2 p2 = vec2(tri[4], tri[5]);
+        DebugDraw::triangle(tri, vec4(1.0f, 0.0f, 0.0f, 1.0f), 1);
+        DebugDraw::line(p0, p1, vec4(1.0f), 2);
+        DebugDraw::line(p1, p2, vec4(1.0f), 2);
+        DebugDraw::line(p2, p0, vec4(1.0f), 2);
+    }
+    DebugDraw::line(pos, pos+CRATER_RAD*normal,
+                    vec4(1.0f, 1.0f, 0.0f, 1.0f), 3);
+}
+
+// --PURPOSE--
+// Whether a circle overlaps the solid bounded by a planet outline, in
+// the planet's own frame. The same question checkCollision answers with
+// the separating axis theorem, answered from the outline instead.
+bool CollisionDetector::outlineCircleCheck(const float* outline,
+                                           float radius,
+                                           const glm::vec2& pos)
+{
+    using namespace glm;
+
+    bool inside = false;
+    for (int v = 0; v < NUM_PLANET_VERTS; ++v)
+    {
+        vec2 e0 = vec2(outline[2*v+2], outline[2*v+3]);
+        vec2 e1 = vec2(outline[2*v+4], outline[2*v+5]);
+
+        // Close enough to the edge?
+        vec2 edge = e1-e0;
+        float ee = dot(edge, edge);
+        float t = (ee > TOL) ? dot(pos-e0, edge)/ee : 0.0f;
+        t = (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+        vec2 off = pos-(e0+t*edge);
+        if (dot(off, off) <= radius*radius) return true;
+
+        // Crossing count for the point itself:
+        if ((e0[1] > pos[1]) != (e1[1] > pos[1])
+            && pos[0] < e0[0]+(pos[1]-e0[1])*edge[0]/edge[1])
+            inside = !inside;
+    }
+    return inside;
+}
+
+// Shared body of checkCollision and getHitTriangles. Without an output
+// list, the first overlapping triangle settles it.
+int CollisionDetector::collide(const planet &p, float rad,
+                               const glm::vec2& pos,
+                               float* hits, int maxHits)
+{
+    int hitCount = 0;
+
+    int first = 0;
+    int vCount = getSectorRange(p, rad, pos, &first);
+    if (-1 == vCount)
+    {
+        // core was hit
+        if (DebugDraw::enabled())
+            DebugDraw::circle(pos, rad, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f), 3);
+        return -1;
+    }
+
+    // Each pair of consecutive vertices makes a triangle with the center:
+    const float* world = p.getWorldData();
+    int v = first;
+    for (int i = 0; i < vCount-1; ++i)
+    {
+        int next = (v+1 < NUM_PLANET_VERTS) ? v+1 : 0;
+        if (fanCircleCheck(p, v, rad, pos))
+        {
+            if (NULL == hits)
+            {
+                hitCount = 1;
+                break;
+            }
+
+            // Record the triangle the bullet intersects:
+            float tri[6] = {
+                world[0],        world[1],
+                world[2*v+2],    world[2*v+3],
+                world[2*next+2], world[2*next+3]
+            };
             #ifdef DEBUG_CD
             fprintf(stdout,
-                    "DRAWING: <%f, %f>, <%f, %f>, <%f, %f>\n\n",
+                    "HIT: <%f, %f>, <%f, %f>, <%f, %f>\n\n",
                     tri[0], tri[1], tri[2], tri[3], tri[4], tri[5]);
             #endif
-            glm::vec2 p0 = glm::vec2(tri[0], tri[1]);
-            glm::vec2 p1 = glm::vec2(tri[2], tri[3]);
-            glm::vec2 p2 = glm::vec2(tri[4], tri[5]);
-            // Red triangle:
-            setDrawLayer(1);
-            setDrawColor(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
-            drawTriangleFan(tri, 3, glm::vec2(0.0f));
-            // White lines:
-            setDrawLayer(2);
-            setDrawColor(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-            drawLine(p0, p1);
-            drawLine(p1, p2);
-            drawLine(p2, p0);
-            collision = true;
+            if (hitCount >= maxHits) break;
+            for (int k = 0; k < 6; ++k) hits[6*hitCount+k] = tri[k];
+            ++hitCount;
         }
+        v = next;
     }
 
-    delete [] triangles;
-    return collision;
+    return hitCount;
 }
 
 // --PURPOSE--
-// Determine the minimum set of triangles such that the object lies
-// within them. This is pretty specific to the planet class.
+// Find the run of outline vertices whose fan triangles could hold the
+// bullet, from its angle in the planet's frame. Vertex i of the outline
+// sits at angle i*TAU/NUM_PLANET_VERTS in that frame, so the sectors
+// follow from one atan2.
 // --PARAMETERS--
-// pl: A planet object.
-// bu: A bullet object.
+// first:   Output, the index of the first vertex of the run.
 // --RETURNS--
-// A pointer to a set of triangles such that the object is in them. User
-// must manage the memory of the retrieved triangle list. 
-GLfloat* CollisionDetector::getTriangleList(const planet& pl,
-                                            const bullet& bu,
-                                            GLint* size)
+// The number of vertices in the run, at least 2, or -1 if the core was
+// hit.
+int CollisionDetector::getSectorRange(const planet& pl, float rad,
+                                      const glm::vec2& pos, int* first)
 {
     using namespace glm;
 
-    GLfloat* planetData = pl.getPlanetData();
-    if (bu.rad >= distance(pl.pos, bu.pos))
+    vec2 p = pos-pl.pos;
+    float dd = dot(p, p);
+    if (rad*rad >= dd)
     {
         // Hit planet center!
         // This would be a good place to crack the planet
         // into smaller chunks.
-        *size = -1;     // signal that core was hit
-        return NULL;
+        return -1;      // signal that core was hit
     }
 
-    // glm uses degrees -- cmath uses radians
-    GLfloat orientDeg = GLfloat(pl.orient*(180.0f/PI));
-
-    // Vectors:
-    vec2 xAxis = vec2(cos(pl.orient), sin(pl.orient));
-    vec2 p = bu.pos-pl.pos;
-    vec2 q = p+bu.rad*normalize(vec2(-p[1], p[0]));
-    // Signed distance from p to xAxis:
-    GLfloat sDis = (p[0]*xAxis[1]-p[1]*xAxis[0])/sqrt(p[0]*p[0]+p[1]*p[1]);
-
-    // Angles:
-    GLfloat radIncrement = TAU/GLfloat(NUM_PLANET_VERTS);
-    GLfloat tmp = dot(p, xAxis)/(length(p)*length(xAxis));
-    GLfloat theta = (tmp >= 1.0f) ? 0.0f : (tmp <= -1.0f) ? PI : acos(tmp);
-    if (0.0f < sDis) theta = TAU-theta;
-    tmp = dot(p, q)/(length(p)*length(q));
-    GLfloat alpha = (tmp >= 1.0f) ? 0.0f : (tmp <= -1.0f) ? PI : acos(tmp);
-
-    GLfloat beta0 = theta-alpha;
-    GLfloat beta1 = theta+alpha;
-    if (beta0 > beta1)
-    {
-        GLfloat swp = beta0;
-        beta0 = beta1;
-        beta1 = swp;
-    }
-    else if (0.0f > beta0)
-    {
-        beta0 += TAU;
-        beta1 += TAU;
-    }
+    // Into the planet's frame with the orientation cached for this tick:
+    float c = pl.orientCos;
+    float s = pl.orientSin;
+    float theta = atan2(c*p[1]-s*p[0], c*p[0]+s*p[1]);
 
-    // Find the upper and lower indices that contain the arc:
-    GLfloat rem0 = GLfloat(GLint(1E6*beta0)%GLint(1E6*radIncrement))/1E6;
-    GLfloat rem1 = GLfloat(GLint(1E6*beta1)%GLint(1E6*radIncrement))/1E6;
-    beta0 -= rem0; beta1 -= rem1-radIncrement;
-    GLint lowerIndex = GLint(round(beta0/radIncrement));
-    GLint upperIndex = GLint(round(beta1/radIncrement));
-    if (lowerIndex == upperIndex)
-    {
-        lowerIndex -= 1;
-        upperIndex += 1;
-    }
+    // Half the angle the bullet covers seen from the center is
+    // asin(rad/|p|), bounded above by its tangent so no trig is needed:
+    float alpha = rad/sqrt(dd-rad*rad);
+    if (alpha >= PI) alpha = PI;
 
-    // Number of vertices that enclose the bullet:
-    GLint vCount = (lowerIndex < upperIndex)
-                    ? upperIndex-lowerIndex+1
-                    : NUM_PLANET_VERTS-(lowerIndex-upperIndex);
+    float radIncrement = TAU/float(NUM_PLANET_VERTS);
+    int lowerIndex = int(floor((theta-alpha)/radIncrement));
+    int upperIndex = int(ceil((theta+alpha)/radIncrement));
+    if (lowerIndex == upperIndex) ++upperIndex;
+
+    // Number of vertices that enclose the bullet, never more than the
+    // whole outline, closed:
+    int vCount = upperIndex-lowerIndex+1;
+    if (vCount > NUM_PLANET_VERTS+1) vCount = NUM_PLANET_VERTS+1;
+
+    lowerIndex %= NUM_PLANET_VERTS;
+    if (lowerIndex < 0) lowerIndex += NUM_PLANET_VERTS;
+    *first = lowerIndex;
 
     #ifdef DEBUG_CD
     // Print this data:
     fprintf(stdout,
             "-----------------------------------------\n"
-            "DEBUG: CollisionDetector::getTriangleList\n"
+            "DEBUG: CollisionDetector::getSectorRange\n"
             "-----------------------------------------\n"
-            "planet: 0x%x\tbullet: 0x%x\n"
-            "radIncrement: %f\n"
+            "planet: %p\tbullet: <%f, %f>\n"
             "theta:        %f\n"
             "alpha:        %f\n"
             "orientation:  %f\n"
             "triangles:    %d\n"
             "lower index:  %d\tupper index: %d\n\n",
-            &pl, &bu,
-            radIncrement,
+            (const void*)&pl, pos[0], pos[1],
             theta,
             alpha,
             pl.orient,
             vCount-1,
             lowerIndex, upperIndex);
     #endif
-    
+
+    return vCount;
+}
+
+// --PURPOSE--
+// Determine the minimum set of triangles such that the object lies
+// within them. This is pretty specific to the planet class.
+// --PARAMETERS--
+// pl:      A planet object.
+// rad:     The radius of the bullet.
+// pos:     The position of the bullet.
+// list:    Output, room for MAX_TRI_LIST floats. Filled with a fan of
+//          triangles such that the object is in them.
+// --RETURNS--
+// The number of floats written to list, or -1 if the core was hit.
+int CollisionDetector::getTriangleList(const planet& pl,
+                                       float rad,
+                                       const glm::vec2& pos,
+                                       float* list)
+{
+    int pIndex = 0;
+    int vCount = getSectorRange(pl, rad, pos, &pIndex);
+    if (-1 == vCount) return -1;
+
     // Joey: Here's an explanation of the list returned!
     // Generate the list to be returned. It's first point
     // is the origin of the planet and the rest of the points
     // are consecutive vertices going around the planet:
-    *size = 2*vCount+2;
-    GLfloat* list = new GLfloat[*size];
-    list[0] = pl.pos[0]; list[1] = pl.pos[1];
-    GLint pIndex = GLint(round(lowerIndex));
-    for (GLint i = 1; i <= vCount; ++i)
+    const float* world = pl.getWorldData();
+    list[0] = world[0]; list[1] = world[1];
+    for (int i = 1; i <= vCount; ++i)
     {
-        vec2 rP = rotate(vec2(planetData[2*pIndex+2],
-                              planetData[2*pIndex+3]), orientDeg);
-        list[2*i] = rP[0]+pl.pos[0];
-        list[2*i+1] = rP[1]+pl.pos[1];
+        list[2*i] = world[2*pIndex+2];
+        list[2*i+1] = world[2*pIndex+3];
         if (++pIndex >= NUM_PLANET_VERTS) pIndex = 0;
     }
 
-    return list;
+    return 2*vCount+2;
+}
+
+// --PURPOSE--
+// Separating axis test between a circle and one triangle of the fan:
+// the center and outline vertices v and v+1. The three axes are the
+// normals cached by planet::updateWorldGeometry().
+bool CollisionDetector::fanCircleCheck(const planet& pl, int v,
+                                       float radius, const glm::vec2& pos)
+{
+    const float* world = pl.getWorldData();
+    const float* edgeN = pl.getEdgeNormals();
+    const float* spokeN = pl.getSpokeNormals();
+    int next = (v+1 < NUM_PLANET_VERTS) ? v+1 : 0;
+
+    const float* axes[3] = {edgeN+2*v, spokeN+2*v, spokeN+2*next};
+    for (int a = 0; a < 3; ++a)
+    {
+        float nx = axes[a][0];
+        float ny = axes[a][1];
+        float c = nx*world[0]+ny*world[1];
+        float p0 = nx*world[2*v+2]+ny*world[2*v+3];
+        float p1 = nx*world[2*v+4]+ny*world[2*v+5];
+        float lo = (p0 < c) ? p0 : c;
+        float hi = (p0 > c) ? p0 : c;
+        lo = (p1 < lo) ? p1 : lo;
+        hi = (p1 > hi) ? p1 : hi;
+
+        float d = nx*pos[0]+ny*pos[1];
+        if (d+radius < lo || d-radius > hi) return false;
+    }
+    return true;
 }
 
 glm::vec2 CollisionDetector::midpoint(const glm::vec2& p0,
                                       const glm::vec2& p1)
 {
     glm::vec2 foo = p1-p0;
-    GLfloat len = glm::length(foo);
+    float len = glm::length(foo);
     return (len/2.0f)*glm::normalize(foo)+p0;
         
 }
@@ -186,7 +879,7 @@ glm::vec2 CollisionDetector::midpoint(const glm::vec2& p0,
 glm::vec2 CollisionDetector::projection(const glm::vec2& v0,
                                         const glm::vec2& axis)
 {
-    GLfloat scalar = glm::dot(v0, axis)/(axis[0]*axis[0]+axis[1]*axis[1]);
+    float scalar = glm::dot(v0, axis)/(axis[0]*axis[0]+axis[1]*axis[1]);
     return scalar*axis;    
 
 }
@@ -200,18 +893,18 @@ glm::vec2 CollisionDetector::projection(const glm::vec2& v0,
 // axis:    The axis to project along.
 // --RETURNS--
 // Pointer to the point that is the maximum projection on the axis.
-GLfloat* CollisionDetector::getMaxAlongAxis(GLfloat* convex,
+float* CollisionDetector::getMaxAlongAxis(float* convex,
     const int verts, const glm::vec2& axis)
 {
-    GLfloat* maxAddress = NULL;
+    float* maxAddress = NULL;
     // Greatest projection length:
-    GLfloat gPL = 0.0f;
+    float gPL = 0.0f;
     // For all vertices:
     for (int v = 0; v < verts; ++v)
     {
         glm::vec2 point = glm::vec2(convex[2*v], convex[2*v+1]);
         // projection length of point <convex[2*v], convex[2*v+1]>:    
-        GLfloat pLen = glm::length(projection(point, axis));
+        float pLen = glm::length(projection(point, axis));
         if (pLen > gPL)
         {
             maxAddress = convex+2*v;    
@@ -230,18 +923,18 @@ GLfloat* CollisionDetector::getMaxAlongAxis(GLfloat* convex,
 // axis:    The axis to project along.
 // --RETURNS--
 // Pointer to the point that is the minimum projection on the axis.
-GLfloat* CollisionDetector::getMinAlongAxis(GLfloat* convex,
+float* CollisionDetector::getMinAlongAxis(float* convex,
     const int verts, const glm::vec2& axis)
 {
-    GLfloat* minAddress = NULL;
+    float* minAddress = NULL;
     // Smallest projection length:
-    GLfloat sPL;
+    float sPL;
     // For all vertices:
     for (int v = 0; v < verts; ++v)
     {
         glm::vec2 point = glm::vec2(convex[2*v], convex[2*v+1]);
         // projection length of point <convex[2*v], convex[2*v+1]>:    
-        GLfloat pLen = glm::length(projection(point, axis));
+        float pLen = glm::length(projection(point, axis));
         if (pLen < sPL || 0 == v)
         {
             minAddress = convex+2*v;    
@@ -251,20 +944,20 @@ GLfloat* CollisionDetector::getMinAlongAxis(GLfloat* convex,
     return minAddress;
 }
 
-GLfloat CollisionDetector::absf(GLfloat fval)
+float CollisionDetector::absf(float fval)
 {
     return (fval < 0.0f) ? -fval : fval;
 }
 
 // Only insert a normal vector that isn't in the normal list.
-void CollisionDetector::insertUniqueNormal(std::vector<glm::vec2>& nList,
+void CollisionDetector::insertUniqueNormal(glm::vec2* nList, int* nCount,
    const glm::vec2& normal)
 {
-    for (int n = 0; n < nList.size(); ++n)
+    for (int n = 0; n < *nCount; ++n)
     {
         // For first check:
-        GLfloat diff0 = absf(nList[n][0]-normal[0]);
-        GLfloat diff1 = absf(nList[n][1]-normal[1]);
+        float diff0 = absf(nList[n][0]-normal[0]);
+        float diff1 = absf(nList[n][1]-normal[1]);
         if ((diff0 <= TOL) && (diff1 <= TOL))
         {
             #ifdef DEBUG_CD
@@ -280,8 +973,8 @@ void CollisionDetector::insertUniqueNormal(std::vector<glm::vec2>& nList,
         }
 
         // For second check:
-        GLfloat diff2 = absf(nList[n][0]+normal[0]);
-        GLfloat diff3 = absf(nList[n][1]+normal[1]);
+        float diff2 = absf(nList[n][0]+normal[0]);
+        float diff3 = absf(nList[n][1]+normal[1]);
         // Try multiplying normal by -1!
         if ((diff2 <= TOL) && (diff3 <= TOL))
         {
@@ -297,10 +990,10 @@ void CollisionDetector::insertUniqueNormal(std::vector<glm::vec2>& nList,
             return;
         }
     }
-    nList.push_back(glm::normalize(normal));
+    nList[(*nCount)++] = glm::normalize(normal);
 }
 
-glm::vec2 CollisionDetector::getPolygonCenter(GLfloat *poly, int vCount)
+glm::vec2 CollisionDetector::getPolygonCenter(float *poly, int vCount)
 {
     glm::vec2 sum = glm::vec2(0.0f);
     for (int i = 0; i < vCount; ++i)
@@ -308,23 +1001,22 @@ glm::vec2 CollisionDetector::getPolygonCenter(GLfloat *poly, int vCount)
         sum = sum + glm::vec2(poly[2*i], poly[2*i+1]);
     }
 
-    glm::vec2 center = sum/GLfloat(vCount);
+    glm::vec2 center = sum/float(vCount);
 
-    // Draw the point:
     #ifdef DEBUG_CD
-    setDrawLayer(6);
-    setDrawColor(glm::vec4(1.0f));
-    drawWireCircle(1.0f, center);    
+    fprintf(stdout, "CENTER: <%f, %f>\n", center[0], center[1]);
     #endif
 
     return center;
 }
 
-bool CollisionDetector::polyCircleCheck(GLfloat* poly, int vCount,
-                                        GLfloat radius, const glm::vec2& pos)
+bool CollisionDetector::polyCircleCheck(float* poly, int vCount,
+                                        float radius, const glm::vec2& pos)
 {
     using glm::vec2;
-    std::vector<vec2> normals;
+    if (vCount > MAX_POLY_VERTS) return false;
+    vec2 normals[MAX_POLY_VERTS];
+    int nCount = 0;
     vec2 tmpNormal;
 
     // Insert normal vectors formed by poly into normal list: 
@@ -333,16 +1025,16 @@ bool CollisionDetector::polyCircleCheck(GLfloat* poly, int vCount,
         // In 2D, normal can be formed easily as so:
         tmpNormal = vec2(-poly[2*i+3]+poly[2*i+1],
                           poly[2*i+2]-poly[2*i]);
-        insertUniqueNormal(normals, tmpNormal);
+        insertUniqueNormal(normals, &nCount, tmpNormal);
     }
     tmpNormal = vec2(-poly[2*(vCount-1)+1]+poly[1],
                       poly[2*(vCount-1)]-poly[0]);
-    insertUniqueNormal(normals, tmpNormal);
+    insertUniqueNormal(normals, &nCount, tmpNormal);
 
     // For each unique normal vector:
-    GLfloat* p0min = NULL;
-    GLfloat* p0max = NULL;
-    for (int i = 0; i < normals.size(); ++i)
+    float* p0min = NULL;
+    float* p0max = NULL;
+    for (int i = 0; i < nCount; ++i)
     {
         // Current normal vector we're working with:
         vec2 cNormal = normals[i];
@@ -375,7 +1067,7 @@ bool CollisionDetector::polyCircleCheck(GLfloat* poly, int vCount,
             "<p0min[0], p0min[1]>: <%f, %f>\n"
             "<p0max[0], p0max[1]>: <%f, %f>\n"
             "VERTICES: <%f, %f>, <%f, %f>, <%f, %f>\n",
-            normals.size(),
+            nCount,
             p0min[0], p0min[1], p0max[0], p0max[1],
             poly[0], poly[1], poly[2], poly[3], poly[4], poly[5]);
     #endif
@@ -384,11 +1076,13 @@ bool CollisionDetector::polyCircleCheck(GLfloat* poly, int vCount,
 }
 
 // Not tested or functional yet.
-bool CollisionDetector::polyPolyCheck(GLfloat* poly0, int vCount0,
-    GLfloat* poly1, int vCount1)
+bool CollisionDetector::polyPolyCheck(float* poly0, int vCount0,
+    float* poly1, int vCount1)
 {
     using glm::vec2;
-    std::vector<vec2> normals;
+    if (vCount0 > MAX_POLY_VERTS || vCount1 > MAX_POLY_VERTS) return false;
+    vec2 normals[2*MAX_POLY_VERTS];
+    int nCount = 0;
     vec2 tmpNormal;
 
     // Insert normal vectors formed by poly0 into normal list: 
@@ -397,11 +1091,11 @@ bool CollisionDetector::polyPolyCheck(GLfloat* poly0, int vCount0,
         // In 2D, normal can be formed easily as so:
         tmpNormal = vec2(-poly0[2*i+3]+poly0[2*i+1],
                           poly0[2*i+2]-poly0[2*i]);
-        insertUniqueNormal(normals, tmpNormal);
+        insertUniqueNormal(normals, &nCount, tmpNormal);
     }
     tmpNormal = vec2(-poly0[2*(vCount0-1)+1]+poly0[1],
                       poly0[2*(vCount0-1)]-poly0[0]);
-    insertUniqueNormal(normals, tmpNormal);
+    insertUniqueNormal(normals, &nCount, tmpNormal);
 
     // Insert normal vectors formed from poly1 into normal list: 
     for (int i = 0; i < vCount1-1; ++i)
@@ -409,22 +1103,22 @@ bool CollisionDetector::polyPolyCheck(GLfloat* poly0, int vCount0,
         // In 2D, normal can be formed easily as so:
         tmpNormal = vec2(-poly1[2*i+3]+poly1[2*i+1],
                           poly1[2*i+2]-poly1[2*i]);
-        insertUniqueNormal(normals, tmpNormal);
+        insertUniqueNormal(normals, &nCount, tmpNormal);
     }
     tmpNormal = vec2(-poly1[2*(vCount0-1)+1]+poly1[1],
                       poly1[2*(vCount0-1)]-poly1[0]);
-    insertUniqueNormal(normals, tmpNormal);
+    insertUniqueNormal(normals, &nCount, tmpNormal);
 
     // For each unique normal vector:
-    for (int i = 0; i < normals.size(); ++i)
+    for (int i = 0; i < nCount; ++i)
     {
         // Current normal vector we're working with:
         vec2 cNormal = normals[i];
         // Find the max and min pointers of each polygon on the normal vector.
-        GLfloat* p0min = getMinAlongAxis(poly0, vCount0, cNormal);
-        GLfloat* p0max = getMaxAlongAxis(poly0, vCount0, cNormal);
-        GLfloat* p1min = getMinAlongAxis(poly1, vCount1, cNormal);
-        GLfloat* p1max = getMaxAlongAxis(poly1, vCount1, cNormal);
+        float* p0min = getMinAlongAxis(poly0, vCount0, cNormal);
+        float* p0max = getMaxAlongAxis(poly0, vCount0, cNormal);
+        float* p1min = getMinAlongAxis(poly1, vCount1, cNormal);
+        float* p1max = getMaxAlongAxis(poly1, vCount1, cNormal);
         // Form the four vectors formed by the max-min projections:
         vec2 p0min_v = projection(vec2(p0min[0], p0min[1]), cNormal);
         vec2 p0max_v = projection(vec2(p0max[0], p0max[1]), cNormal);
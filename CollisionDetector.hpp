@@ -2,34 +2,81 @@
 #define COLLISIONDETECTOR_HPP_
 
 #include <glm/glm.hpp>
-#include <glm/gtx/rotate_vector.hpp>
 #include "satellite.hpp"
 #include "constants.hpp"
-#include "draw.hpp"
-#include <vector>
 
 class CollisionDetector
 {
+    // bench.cpp times the private stages directly, and check.cpp checks
+    // them:
+    friend struct CollisionBench;
+    friend struct CollisionCheck;
 public:
     static bool checkCollision(const planet& p, const bullet& b);
+    static bool checkCollision(const planet& p, float rad,
+                               const glm::vec2& pos);
+    static int getHitTriangles(const planet& p, float rad,
+                               const glm::vec2& pos,
+                               float* tris, int maxTris);
+    static int sweepCollisions(const planet& p, const float* x0,
+                               const float* y0, const float* x1,
+                               const float* y1, const float* rad,
+                               const int* index, int count,
+                               unsigned* mask);
+    static bool sweepCollision(const planet& p, float rad,
+                               const glm::vec2& p0, const glm::vec2& p1,
+                               float* toi, float spin = 0.0f);
+    // Distance field queries, see DistanceField:
+    static bool checkDistanceField(const planet& p, float rad,
+                                   const glm::vec2& pos);
+    static bool sweepDistanceField(const planet& p, float rad,
+                                   const glm::vec2& p0, const glm::vec2& p1,
+                                   float* toi, float spin = 0.0f);
+    static glm::vec2 surfaceNormal(const planet& p, const glm::vec2& pos);
+    static void recordContact(const planet& p, float rad,
+                              const glm::vec2& pos, const glm::vec2& normal);
 private:
+    // Batched sweepCollisions paths, see GravityKernel:
+    static void batchScalar(const planet& p, const float* edges,
+                            const float* const* ends,
+                            const float* rad, const int* index,
+                            int first, int count, unsigned* mask);
+    static void batchSSE4(const planet& p, const float* edges,
+                          const float* const* ends,
+                          const float* rad, const int* index,
+                          int count, unsigned* mask);
+    static void batchAVX2(const planet& p, const float* edges,
+                          const float* const* ends,
+                          const float* rad, const int* index,
+                          int count, unsigned* mask);
+    static bool toPlanetFrame(const planet& p, float rad,
+                              const glm::vec2& p0, const glm::vec2& p1,
+                              float spin, glm::vec2* q0, glm::vec2* q1);
+    static bool outlineCircleCheck(const float* outline, float radius,
+                                   const glm::vec2& pos);
+    static int collide(const planet& p, float rad, const glm::vec2& pos,
+                       float* hits, int maxHits);
+    static int getSectorRange(const planet& p, float rad,
+                              const glm::vec2& pos, int* first);
     // Separating axis theorem:
-    static GLfloat* getTriangleList(const planet& p, const bullet& b,
-                                    GLint* size);
-    static bool polyCircleCheck(GLfloat* poly, int vCount,
-                                GLfloat radius, const glm::vec2& pos);
-    static bool polyPolyCheck(GLfloat* poly0, int vCount0,
-                              GLfloat* poly1, int vCount1);
-    static glm::vec2 getPolygonCenter(GLfloat* poly, int vCount);
+    static bool fanCircleCheck(const planet& p, int v, float radius,
+                               const glm::vec2& pos);
+    static int getTriangleList(const planet& p, float rad,
+                               const glm::vec2& pos, float* list);
+    static bool polyCircleCheck(float* poly, int vCount,
+                                float radius, const glm::vec2& pos);
+    static bool polyPolyCheck(float* poly0, int vCount0,
+                              float* poly1, int vCount1);
+    static glm::vec2 getPolygonCenter(float* poly, int vCount);
     static glm::vec2 projection(const glm::vec2& v0, const glm::vec2& axis);
     static glm::vec2 midpoint(const glm::vec2& p0, const glm::vec2& p1);
-    static void insertUniqueNormal(std::vector<glm::vec2>& nList,
+    static void insertUniqueNormal(glm::vec2* nList, int* nCount,
                                    const glm::vec2& normal);
-    static GLfloat* getMaxAlongAxis(GLfloat* convex, const int verts,
-                                   const glm::vec2& axis);    
-    static GLfloat* getMinAlongAxis(GLfloat* convex, const int verts,
-                                   const glm::vec2& axis);    
-    static GLfloat absf(GLfloat fval);
+    static float* getMaxAlongAxis(float* convex, const int verts,
+                                  const glm::vec2& axis);    
+    static float* getMinAlongAxis(float* convex, const int verts,
+                                  const glm::vec2& axis);    
+    static float absf(float fval);
 };
 
 #endif
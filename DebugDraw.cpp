@@ -0,0 +1,92 @@
+// DebugDraw.cpp
+#include "DebugDraw.hpp"
+
+std::atomic<bool> DebugDraw::on(false);
+std::mutex DebugDraw::lock;
+std::vector<DebugDraw::command> DebugDraw::commands;
+int DebugDraw::droppedCount = 0;
+
+// Turn recording on or off. Turning it off drops what was recorded:
+void DebugDraw::enable(bool enabled)
+{
+    on.store(enabled, std::memory_order_relaxed);
+    if (!enabled) clear();
+}
+
+void DebugDraw::line(const glm::vec2& p0, const glm::vec2& p1,
+                     const glm::vec4& color, int layer)
+{
+    command cmd;
+    cmd.shape = DEBUG_LINE;
+    cmd.layer = layer;
+    cmd.color = color;
+    cmd.data[0] = p0[0];
+    cmd.data[1] = p0[1];
+    cmd.data[2] = p1[0];
+    cmd.data[3] = p1[1];
+    record(cmd);
+}
+
+// tri: x, y of the three corners.
+void DebugDraw::triangle(const float* tri, const glm::vec4& color,
+                         int layer)
+{
+    command cmd;
+    cmd.shape = DEBUG_TRIANGLE;
+    cmd.layer = layer;
+    cmd.color = color;
+    for (int k = 0; k < 6; ++k) cmd.data[k] = tri[k];
+    record(cmd);
+}
+
+void DebugDraw::circle(const glm::vec2& pos, float rad,
+                       const glm::vec4& color, int layer)
+{
+    command cmd;
+    cmd.shape = DEBUG_CIRCLE;
+    cmd.layer = layer;
+    cmd.color = color;
+    cmd.data[0] = pos[0];
+    cmd.data[1] = pos[1];
+    cmd.data[2] = rad;
+    record(cmd);
+}
+
+// Append a command, unless recording is off or nobody has taken the
+// buffer in DEBUG_DRAW_CAPACITY commands, e.g. with no renderer:
+void DebugDraw::record(const command& cmd)
+{
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> guard(lock);
+    if (int(commands.size()) >= DEBUG_DRAW_CAPACITY)
+    {
+        ++droppedCount;
+        return;
+    }
+    commands.push_back(cmd);
+}
+
+// --PURPOSE--
+// Hand everything recorded so far to the renderer and start over.
+// --PARAMETERS--
+// out:     Replaced by the recorded commands. Its old storage becomes
+//          the new buffer, so swapping the same vector every frame
+//          settles into no allocations.
+// --RETURNS--
+// The number of commands dropped for lack of room since the last take.
+int DebugDraw::take(std::vector<command>& out)
+{
+    out.clear();
+    std::lock_guard<std::mutex> guard(lock);
+    commands.swap(out);
+    int lost = droppedCount;
+    droppedCount = 0;
+    return lost;
+}
+
+void DebugDraw::clear()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    commands.clear();
+    droppedCount = 0;
+}
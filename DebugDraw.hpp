@@ -0,0 +1,62 @@
+// DebugDraw.hpp
+#ifndef DEBUGDRAW_HPP_
+#define DEBUGDRAW_HPP_
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <glm/glm.hpp>
+#include "constants.hpp"
+
+// Primitives a debug command can hold:
+enum DebugShape
+{
+    DEBUG_LINE     = 0,     // two points
+    DEBUG_TRIANGLE = 1,     // three points, filled
+    DEBUG_CIRCLE   = 2      // center and radius, outlined
+};
+
+//------------------//
+// Debug Draw Class //
+//------------------//
+// Command buffer for debug visualization. Simulation code records
+// primitives in game coordinates and the renderer takes the whole buffer
+// once a frame and draws it in one pass, so recording never needs a GL
+// context. Recording is off until enable(true); callers test enabled()
+// first so that the hot paths pay one load when it is off. Safe to
+// record from several threads at once.
+class DebugDraw
+{
+public:
+    struct command
+    {
+        DebugShape shape;
+        int layer;
+        glm::vec4 color;
+        float data[6];
+    };
+
+    static bool enabled();
+    static void enable(bool on);
+    static void line(const glm::vec2& p0, const glm::vec2& p1,
+                     const glm::vec4& color, int layer);
+    static void triangle(const float* tri, const glm::vec4& color,
+                         int layer);
+    static void circle(const glm::vec2& pos, float rad,
+                       const glm::vec4& color, int layer);
+    static int take(std::vector<command>& out);
+    static void clear();
+private:
+    static void record(const command& cmd);
+
+    static std::atomic<bool> on;
+    static std::mutex lock;
+    static std::vector<command> commands;
+    static int droppedCount;    // since the last take
+};
+
+inline bool DebugDraw::enabled()
+{
+    return on.load(std::memory_order_relaxed);
+}
+
+#endif
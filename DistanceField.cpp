@@ -0,0 +1,222 @@
+// DistanceField.cpp
+#include "DistanceField.hpp"
+#include <cmath>
+
+// Default constructor, empty until built:
+DistanceField::DistanceField()
+{
+    this->bound = 0.0f;
+    this->extent = 0.0f;
+    this->cellSize = 1.0f;
+    this->invCell = 1.0f;
+    this->sampleError = 0.0f;
+}
+
+// --PURPOSE--
+// Bake the field for a planet outline.
+// --PARAMETERS--
+// outline:     Planet data as made by createPlanetData: the center, then
+//              NUM_PLANET_VERTS vertices, then the first vertex again.
+void DistanceField::build(const float* outline)
+{
+    if (NULL == outline)
+    {
+        this->clear();
+        return;
+    }
+
+    this->bound = 0.0f;
+    for (int v = 1; v <= NUM_PLANET_VERTS; ++v)
+    {
+        float len = sqrtf(outline[2*v]*outline[2*v]
+                          +outline[2*v+1]*outline[2*v+1]);
+        if (len > this->bound) this->bound = len;
+    }
+    this->extent = this->bound*(1.0f+SDF_MARGIN);
+    this->cellSize = 2.0f*this->extent/float(SDF_RESOLUTION-1);
+    this->invCell = 1.0f/this->cellSize;
+    // A sample blends nodes no further than this from it, and the true
+    // distance changes at most as fast as the point moves. With a hair of
+    // slack for rounding:
+    this->sampleError = 0.5f*sqrtf(2.0f)*this->cellSize+float(TOL);
+    this->dist.resize(SDF_RESOLUTION*SDF_RESOLUTION);
+
+    // Exact distance to the nearest edge at every node:
+    float edges[OUTLINE_EDGE_FLOATS*NUM_PLANET_VERTS];
+    edgeTable(outline, edges);
+    for (int r = 0; r < SDF_RESOLUTION; ++r)
+    {
+        float py = -this->extent+r*this->cellSize;
+        for (int c = 0; c < SDF_RESOLUTION; ++c)
+        {
+            float px = -this->extent+c*this->cellSize;
+            this->dist[r*SDF_RESOLUTION+c] = this->truncate(
+                nodeDistance(edges, px, py));
+        }
+    }
+}
+
+// --PURPOSE--
+// Bring the field up to date after part of the outline moved, without
+// baking it all again. A node can only change if the moved edges come
+// closer to it than its stored distance, so only those nodes, at most
+// SDF_TRUNCATE cells from the change, are recomputed. The bound and extent are kept, the outline may only have
+// shrunk.
+// --PARAMETERS--
+// outline:         The outline after the change.
+// x0, y0, x1, y1:  Box around every edge that moved, before and after.
+// --RETURNS--
+// The number of nodes recomputed.
+int DistanceField::patch(const float* outline, float x0, float y0,
+                         float x1, float y1)
+{
+    if (this->empty() || NULL == outline) return 0;
+
+    float edges[OUTLINE_EDGE_FLOATS*NUM_PLANET_VERTS];
+    edgeTable(outline, edges);
+    int count = 0;
+    for (int r = 0; r < SDF_RESOLUTION; ++r)
+    {
+        float py = -this->extent+r*this->cellSize;
+        float dy = (py < y0) ? y0-py : (py > y1) ? py-y1 : 0.0f;
+        for (int c = 0; c < SDF_RESOLUTION; ++c)
+        {
+            float px = -this->extent+c*this->cellSize;
+            float dx = (px < x0) ? x0-px : (px > x1) ? px-x1 : 0.0f;
+            // With a hair of slack, so ties lost to rounding are redone:
+            float& d = this->dist[r*SDF_RESOLUTION+c];
+            float reach = 1.001f*fabsf(d)+float(TOL);
+            if (dx*dx+dy*dy > reach*reach) continue;
+            d = this->truncate(nodeDistance(edges, px, py));
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Clamp a distance to SDF_TRUNCATE cells, keeping its sign:
+float DistanceField::truncate(float d) const
+{
+    float limit = SDF_TRUNCATE*this->cellSize;
+    return (d > limit) ? limit : (d < -limit) ? -limit : d;
+}
+
+// Everything about each outline edge that doesn't depend on the node,
+// OUTLINE_EDGE_FLOATS per edge:
+void DistanceField::edgeTable(const float* outline, float* edges)
+{
+    for (int v = 0; v < NUM_PLANET_VERTS; ++v)
+    {
+        float* e = edges+OUTLINE_EDGE_FLOATS*v;
+        float dx = outline[2*v+4]-outline[2*v+2];
+        float dy = outline[2*v+5]-outline[2*v+3];
+        float ee = dx*dx+dy*dy;
+        e[0] = outline[2*v+2];
+        e[1] = outline[2*v+3];
+        e[2] = dx;
+        e[3] = dy;
+        e[4] = (ee > TOL) ? 1.0f/ee : 0.0f;
+        e[5] = (0.0f != dy) ? dx/dy : 0.0f;
+    }
+}
+
+// Exact signed distance from a point to the outline, signed by the same
+// crossing count as CollisionDetector::outlineCircleCheck:
+float DistanceField::nodeDistance(const float* edges, float px, float py)
+{
+    float best = 1E30f;
+    int crossings = 0;
+    for (int v = 0; v < NUM_PLANET_VERTS; ++v)
+    {
+        const float* e = edges+OUTLINE_EDGE_FLOATS*v;
+        float mx = px-e[0];
+        float my = py-e[1];
+        float t = (mx*e[2]+my*e[3])*e[4];
+        t = (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+        float ox = mx-t*e[2];
+        float oy = my-t*e[3];
+        float dd = ox*ox+oy*oy;
+        best = (dd < best) ? dd : best;
+
+        crossings += ((e[1] > py) != (e[1]+e[3] > py)) & (mx < my*e[5]);
+    }
+    float d = sqrtf(best);
+    return (crossings & 1) ? -d : d;
+}
+
+// Forget the outline. Everything is then out of reach:
+void DistanceField::clear()
+{
+    this->bound = 0.0f;
+    this->extent = 0.0f;
+    this->dist.clear();
+}
+
+bool DistanceField::empty() const
+{
+    return this->dist.empty();
+}
+
+// --PURPOSE--
+// Signed distance from a point in the planet frame to the outline.
+// --RETURNS--
+// The bilinear sample, off the grid a lower bound instead.
+float DistanceField::distance(float x, float y) const
+{
+    float fx = (x+this->extent)*this->invCell;
+    float fy = (y+this->extent)*this->invCell;
+    if (!(fx >= 0.0f && fy >= 0.0f
+          && fx < SDF_RESOLUTION-1 && fy < SDF_RESOLUTION-1))
+        return sqrtf(x*x+y*y)-this->bound;
+
+    int c = int(fx);
+    int r = int(fy);
+    float tx = fx-c;
+    float ty = fy-r;
+    const float* n = &this->dist[r*SDF_RESOLUTION+c];
+    return (1.0f-ty)*((1.0f-tx)*n[0]+tx*n[1])
+         + ty*((1.0f-tx)*n[SDF_RESOLUTION]+tx*n[SDF_RESOLUTION+1]);
+}
+
+// --PURPOSE--
+// How far a point in the planet frame is sure to be from the outline,
+// e.g. to sphere trace by.
+// --RETURNS--
+// distance() less the most it can overestimate by. Never more than the
+// exact signed distance, though it can be negative outside the planet.
+float DistanceField::clearance(float x, float y) const
+{
+    return this->distance(x, y)-this->sampleError;
+}
+
+// --PURPOSE--
+// Outward surface normal near a point in the planet frame, from the
+// gradient of the bilinear sample.
+// --RETURNS--
+// A unit vector, pointing away from the center where the gradient
+// vanishes or off the grid.
+glm::vec2 DistanceField::normal(float x, float y) const
+{
+    using glm::vec2;
+
+    vec2 radial = vec2(x, y);
+    float len = glm::length(radial);
+    radial = (len > TOL) ? radial/len : vec2(1.0f, 0.0f);
+
+    float fx = (x+this->extent)*this->invCell;
+    float fy = (y+this->extent)*this->invCell;
+    if (!(fx >= 0.0f && fy >= 0.0f
+          && fx < SDF_RESOLUTION-1 && fy < SDF_RESOLUTION-1))
+        return radial;
+
+    int c = int(fx);
+    int r = int(fy);
+    float tx = fx-c;
+    float ty = fy-r;
+    const float* n = &this->dist[r*SDF_RESOLUTION+c];
+    vec2 grad = vec2(
+        (1.0f-ty)*(n[1]-n[0]) + ty*(n[SDF_RESOLUTION+1]-n[SDF_RESOLUTION]),
+        (1.0f-tx)*(n[SDF_RESOLUTION]-n[0]) + tx*(n[SDF_RESOLUTION+1]-n[1]));
+    float gLen = glm::length(grad);
+    return (gLen > TOL) ? grad/gLen : radial;
+}
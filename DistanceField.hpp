@@ -0,0 +1,47 @@
+// DistanceField.hpp
+#ifndef DISTANCEFIELD_HPP_
+#define DISTANCEFIELD_HPP_
+#include <vector>
+#include <glm/glm.hpp>
+#include "constants.hpp"
+
+//----------------------//
+// Distance Field Class //
+//----------------------//
+// Signed distance to a planet outline, baked on a square grid of
+// SDF_RESOLUTION nodes a side in the planet's own frame and sampled
+// bilinearly. Negative inside the planet. Planets only turn, so the
+// field is built once per shape and a query is a rotation into the
+// planet frame plus one lookup, however fine the outline is. Distances
+// are truncated at SDF_TRUNCATE cells, since away from the surface only
+// the sign and a lower bound are needed, and that keeps the nodes a
+// crater can change close to it. Off the grid, distance() falls back to
+// the distance to the bounding circle, which never overestimates. On the
+// grid the nodes are exact, but blending them can overestimate near
+// concave corners, by up to half a cell diagonal. clearance() takes that
+// off, for callers that must not step past the surface.
+class DistanceField
+{
+public:
+    DistanceField();
+    void build(const float* outline);
+    int patch(const float* outline, float x0, float y0, float x1, float y1);
+    void clear();
+    bool empty() const;
+    float distance(float x, float y) const;
+    float clearance(float x, float y) const;
+    glm::vec2 normal(float x, float y) const;
+private:
+    static void edgeTable(const float* outline, float* edges);
+    static float nodeDistance(const float* edges, float px, float py);
+    float truncate(float d) const;
+
+    float bound;        // largest distance of the outline from the center
+    float extent;       // the grid spans [-extent, extent] both ways
+    float cellSize;
+    float invCell;
+    float sampleError;  // most a bilinear sample can overestimate by
+    std::vector<float> dist;    // row major, SDF_RESOLUTION squared
+};
+
+#endif
@@ -0,0 +1,135 @@
+// FrameScheduler.cpp
+#include "FrameScheduler.hpp"
+#include <thread>
+
+// --PURPOSE--
+// Start with a frame due right away.
+// --PARAMETERS--
+// imode:   How frames are paced, see FrameMode.
+// irate:   Frames per second aimed for, which is also the budget.
+FrameScheduler::FrameScheduler(FrameMode imode, float irate)
+{
+    this->mode = imode;
+    this->period = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(1.0/FRAME_HZ));
+    this->setRate(irate);
+    this->deadline = clock::now();
+    this->frameStart = this->deadline;
+    this->reportStart = this->deadline;
+    this->frames = 0;
+    this->missed = 0;
+    this->workSum = 0.0;
+    this->slackSum = 0.0;
+    this->slackMin = 0.0;
+}
+
+// Switch pacing, with the next frame due right away:
+void FrameScheduler::setMode(FrameMode nmode)
+{
+    this->mode = nmode;
+    this->deadline = clock::now();
+}
+
+FrameMode FrameScheduler::getMode() const
+{
+    return this->mode;
+}
+
+// Set the frames per second aimed for. Rates of 0 or less are ignored:
+void FrameScheduler::setRate(float nrate)
+{
+    if (0.0f >= nrate) return;
+    this->period = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(1.0/nrate));
+}
+
+float FrameScheduler::getRate() const
+{
+    return 1.0f/std::chrono::duration<float>(this->period).count();
+}
+
+// Call when a frame starts its work:
+void FrameScheduler::beginFrame()
+{
+    this->frameStart = clock::now();
+}
+
+// --PURPOSE--
+// Call when a frame's work is done. Records how long it took against
+// the budget, and works out when the next frame is due.
+void FrameScheduler::endFrame()
+{
+    clock::time_point now = clock::now();
+    double work = std::chrono::duration<double, std::milli>(
+        now-this->frameStart).count();
+    double slack = std::chrono::duration<double, std::milli>(
+        this->period).count()-work;
+    this->workSum += work;
+    this->slackSum += slack;
+    this->slackMin = (0 == this->frames || slack < this->slackMin)
+                     ? slack : this->slackMin;
+    this->missed += (0.0 > slack) ? 1 : 0;
+    ++this->frames;
+
+    if (FRAME_CAPPED != this->mode)
+    {
+        this->deadline = now;
+        return;
+    }
+    // A late frame makes the next one due at once, and the periods after
+    // it count from there:
+    this->deadline += this->period;
+    if (this->deadline < now) this->deadline = now;
+}
+
+// --RETURNS--
+// How long until the next frame is due, 0 if it already is.
+FrameScheduler::clock::duration FrameScheduler::untilDue() const
+{
+    clock::duration left = this->deadline-clock::now();
+    return (left > clock::duration::zero()) ? left : clock::duration::zero();
+}
+
+// Sleep until the next frame is due. Only FRAME_CAPPED ever sleeps:
+void FrameScheduler::waitForDeadline() const
+{
+    if (FRAME_CAPPED == this->mode)
+        std::this_thread::sleep_until(this->deadline);
+}
+
+// --PURPOSE--
+// Hand out the frame times once every FRAME_REPORT_SECONDS, and start
+// over.
+// --RETURNS--
+// True if out was filled.
+bool FrameScheduler::takeReport(report& out)
+{
+    clock::time_point now = clock::now();
+    float seconds = std::chrono::duration<float>(now-this->reportStart).count();
+    if (seconds < FRAME_REPORT_SECONDS || 0 == this->frames) return false;
+
+    out.frames = this->frames;
+    out.missed = this->missed;
+    out.meanWork = float(this->workSum/this->frames);
+    out.meanSlack = float(this->slackSum/this->frames);
+    out.minSlack = float(this->slackMin);
+    out.seconds = seconds;
+
+    this->reportStart = now;
+    this->frames = 0;
+    this->missed = 0;
+    this->workSum = 0.0;
+    this->slackSum = 0.0;
+    this->slackMin = 0.0;
+    return true;
+}
+
+const char* FrameScheduler::modeName(FrameMode nmode)
+{
+    switch (nmode)
+    {
+        case FRAME_VSYNC: return "vsync";
+        case FRAME_UNCAPPED: return "uncapped";
+        default: return "capped";
+    }
+}
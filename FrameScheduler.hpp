@@ -0,0 +1,68 @@
+// FrameScheduler.hpp
+#ifndef FRAMESCHEDULER_HPP_
+#define FRAMESCHEDULER_HPP_
+#include <chrono>
+#include "constants.hpp"
+
+// How frames are paced:
+enum FrameMode
+{
+    FRAME_CAPPED   = 0,     // sleep until the next deadline at the target rate
+    FRAME_VSYNC    = 1,     // let the buffer swap wait for the display
+    FRAME_UNCAPPED = 2      // draw again as soon as a frame is done
+};
+
+//-----------------------//
+// Frame Scheduler Class //
+//-----------------------//
+// Decides when the next frame is due and measures how much of each
+// frame's budget was left over. In FRAME_CAPPED mode deadlines fall
+// every 1/rate seconds on a monotonic clock and the caller sleeps until
+// them, so a window that has nothing to do uses no CPU. A frame that
+// misses its deadline starts the next period from when it finished
+// instead of rushing to catch up. In the other modes a frame is due as
+// soon as the last one is done, and the budget is still 1/rate, to
+// tell how close the drawing comes to keeping up. Makes no GL calls.
+class FrameScheduler
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    // Frame times over a reporting period, in milliseconds:
+    struct report
+    {
+        int frames;
+        int missed;         // frames that ran over their budget
+        float meanWork;     // from beginFrame to endFrame
+        float meanSlack;    // budget left after the work
+        float minSlack;
+        float seconds;      // length of the period
+    };
+
+    FrameScheduler(FrameMode imode = FRAME_CAPPED, float irate = FRAME_HZ);
+    void setMode(FrameMode nmode);
+    FrameMode getMode() const;
+    void setRate(float nrate);
+    float getRate() const;
+    void beginFrame();
+    void endFrame();
+    clock::duration untilDue() const;
+    void waitForDeadline() const;
+    bool takeReport(report& out);
+    static const char* modeName(FrameMode nmode);
+private:
+    FrameMode mode;
+    clock::duration period;
+    clock::time_point deadline;     // when the next frame is due
+    clock::time_point frameStart;
+
+    // Sums since the last report:
+    clock::time_point reportStart;
+    int frames;
+    int missed;
+    double workSum;
+    double slackSum;
+    double slackMin;
+};
+
+#endif
@@ -0,0 +1,154 @@
+// GravityField.cpp
+#include "GravityField.hpp"
+#include <cmath>
+
+// Default constructor, covers nothing until resized:
+GravityField::GravityField()
+{
+    this->minX = this->minY = 0.0f;
+    this->maxX = this->maxY = 0.0f;
+    this->cellSize = 1.0f;
+    this->invCell = 1.0f;
+    this->cols = 0;
+    this->rows = 0;
+}
+
+// --PURPOSE--
+// Cover a new area with an empty field.
+// --PARAMETERS--
+// x0, y0, x1, y1:  Corners of the area.
+// icellSize:       Spacing of the grid nodes.
+void GravityField::resize(float x0, float y0, float x1, float y1,
+                          float icellSize)
+{
+    this->minX = x0;
+    this->minY = y0;
+    this->maxX = x1;
+    this->maxY = y1;
+    this->cellSize = icellSize;
+    this->invCell = 1.0f/icellSize;
+    this->cols = int(ceilf((x1-x0)*this->invCell));
+    this->rows = int(ceilf((y1-y0)*this->invCell));
+    if (this->cols < 1) this->cols = 1;
+    if (this->rows < 1) this->rows = 1;
+    this->clear();
+}
+
+// Whether resize() was last called with these arguments:
+bool GravityField::covers(float x0, float y0, float x1, float y1,
+                          float icellSize) const
+{
+    return 0 != this->cols
+        && x0 == this->minX && y0 == this->minY
+        && x1 == this->maxX && y1 == this->maxY
+        && icellSize == this->cellSize;
+}
+
+// Remove every body:
+void GravityField::clear()
+{
+    this->field.assign(2*this->nodeCount(), 0.0f);
+    this->exactCount.assign(this->cols*this->rows, 0);
+}
+
+int GravityField::nodeCount() const
+{
+    return (0 == this->cols) ? 0 : (this->cols+1)*(this->rows+1);
+}
+
+// --PURPOSE--
+// Add one body's pull to the field.
+// --PARAMETERS--
+// x, y:    Body position.
+// gm:      Scaled GRAVITATIONAL*mass, as the bullets feel it.
+// rad:     Body radius. Cells within FIELD_EXACT_SCALE*rad of the body
+//          are left to the exact sum.
+void GravityField::addBody(float x, float y, float gm, float rad)
+{
+    splat(x, y, gm, rad, 1);
+}
+
+// Undo addBody with the same arguments:
+void GravityField::removeBody(float x, float y, float gm, float rad)
+{
+    splat(x, y, gm, rad, -1);
+}
+
+void GravityField::splat(float x, float y, float gm, float rad, int sign)
+{
+    // Same pull as GravityKernel, node by node:
+    float sgm = sign*gm;
+    for (int r = 0; r <= this->rows; ++r)
+    {
+        float ny = this->minY + r*this->cellSize;
+        float* row = &this->field[2*r*(this->cols+1)];
+        for (int c = 0; c <= this->cols; ++c)
+        {
+            float dx = x - (this->minX + c*this->cellSize);
+            float dy = y - ny;
+            float sqrDis = dx*dx + dy*dy;
+            if (0.0f >= sqrDis) continue;
+            float fg = sgm/(sqrDis*sqrtf(sqrDis));
+            row[2*c] += fg*dx;
+            row[2*c+1] += fg*dy;
+        }
+    }
+
+    // Flag the cells that touch the circle around the body:
+    float reach = FIELD_EXACT_SCALE*rad;
+    int c0 = int(floorf((x-reach-this->minX)*this->invCell));
+    int c1 = int(floorf((x+reach-this->minX)*this->invCell));
+    int r0 = int(floorf((y-reach-this->minY)*this->invCell));
+    int r1 = int(floorf((y+reach-this->minY)*this->invCell));
+    if (c0 < 0) c0 = 0;
+    if (r0 < 0) r0 = 0;
+    if (c1 >= this->cols) c1 = this->cols-1;
+    if (r1 >= this->rows) r1 = this->rows-1;
+    for (int r = r0; r <= r1; ++r)
+    {
+        for (int c = c0; c <= c1; ++c)
+        {
+            // Closest point of the cell to the body:
+            float cx = this->minX + c*this->cellSize;
+            float cy = this->minY + r*this->cellSize;
+            float dx = x - ((x < cx) ? cx : (x > cx+this->cellSize)
+                                          ? cx+this->cellSize : x);
+            float dy = y - ((y < cy) ? cy : (y > cy+this->cellSize)
+                                          ? cy+this->cellSize : y);
+            if (dx*dx + dy*dy <= reach*reach)
+                this->exactCount[r*this->cols+c] += sign;
+        }
+    }
+}
+
+// --PURPOSE--
+// Look up the pull at a point.
+// --PARAMETERS--
+// ax, ay:  Output, the acceleration at (x, y). Multiply by the bullet's
+//          mass for the force.
+// --RETURNS--
+// false if the point is off the field or near a body, in which case the
+// caller should evaluate the pull exactly.
+bool GravityField::sample(float x, float y, float* ax, float* ay) const
+{
+    float fx = (x-this->minX)*this->invCell;
+    float fy = (y-this->minY)*this->invCell;
+    if (!(fx >= 0.0f && fy >= 0.0f && fx < this->cols && fy < this->rows))
+        return false;
+
+    int c = int(fx);
+    int r = int(fy);
+    if (0 != this->exactCount[r*this->cols+c]) return false;
+
+    float tx = fx-c;
+    float ty = fy-r;
+    const float* n0 = &this->field[2*(r*(this->cols+1)+c)];
+    const float* n1 = n0+2*(this->cols+1);
+    float x0 = n0[0] + tx*(n0[2]-n0[0]);
+    float y0 = n0[1] + tx*(n0[3]-n0[1]);
+    float x1 = n1[0] + tx*(n1[2]-n1[0]);
+    float y1 = n1[1] + tx*(n1[3]-n1[1]);
+    *ax = x0 + ty*(x1-x0);
+    *ay = y0 + ty*(y1-y0);
+    return true;
+}
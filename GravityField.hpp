@@ -0,0 +1,40 @@
+// GravityField.hpp
+#ifndef GRAVITYFIELD_HPP_
+#define GRAVITYFIELD_HPP_
+#include <vector>
+#include "constants.hpp"
+
+//---------------------//
+// Gravity Field Class //
+//---------------------//
+// Cache of the planets' pull over the play area. Acceleration is stored
+// on the nodes of a regular grid and sampled bilinearly, which makes a
+// lookup O(1) instead of O(planets). Bodies are added and removed one at
+// a time, so a change to one planet only costs one pass over the grid.
+// Cells close to a body are flagged, and sample() refuses them so the
+// caller falls back to the exact sum where the field curves too hard to
+// interpolate.
+class GravityField
+{
+public:
+    GravityField();
+    void resize(float x0, float y0, float x1, float y1, float icellSize);
+    bool covers(float x0, float y0, float x1, float y1,
+                float icellSize) const;
+    void clear();
+    void addBody(float x, float y, float gm, float rad);
+    void removeBody(float x, float y, float gm, float rad);
+    bool sample(float x, float y, float* ax, float* ay) const;
+    int nodeCount() const;
+private:
+    void splat(float x, float y, float gm, float rad, int sign);
+
+    float minX, minY, maxX, maxY;
+    float cellSize;
+    float invCell;
+    int cols, rows;                 // cells, the nodes are one more each way
+    std::vector<float> field;       // x, y acceleration at each node
+    std::vector<int> exactCount;    // bodies too close to each cell
+};
+
+#endif
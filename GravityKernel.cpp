@@ -0,0 +1,196 @@
+// GravityKernel.cpp
+#include "GravityKernel.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GRAVITY_X86
+#include <immintrin.h>
+#endif
+
+int GravityKernel::path = -1;
+
+// --PURPOSE--
+// Sum the gravitational acceleration of every planet on a set of bullets.
+// --PARAMETERS--
+// bx, by:     Bullet positions, indexed by slot.
+// index:      The slots to work on.
+// count:      Number of entries in index.
+// px, py:     Planet positions.
+// gm:         GRAVITATIONAL*mass of each planet.
+// pCount:     Number of planets.
+// ax, ay:     Output, one acceleration per entry of index. Multiply by
+//             the bullet's mass for the force.
+void GravityKernel::accumulate(const float* bx, const float* by,
+                               const int* index, int count,
+                               const float* px, const float* py,
+                               const float* gm, int pCount,
+                               float* ax, float* ay)
+{
+    switch (getPath())
+    {
+        case GRAVITY_AVX2:
+            avx2(bx, by, index, count, px, py, gm, pCount, ax, ay);
+            break;
+        case GRAVITY_SSE4:
+            sse4(bx, by, index, count, px, py, gm, pCount, ax, ay);
+            break;
+        default:
+            scalar(bx, by, index, 0, count, px, py, gm, pCount, ax, ay);
+            break;
+    }
+}
+
+GravityPath GravityKernel::getPath()
+{
+    if (-1 == path) path = bestPath();
+    return GravityPath(path);
+}
+
+// Force a path, e.g. to compare against the scalar reference. Paths the
+// CPU can't run are clamped down to the best one it can.
+GravityPath GravityKernel::setPath(GravityPath npath)
+{
+    GravityPath best = bestPath();
+    path = (npath > best) ? best : npath;
+    return GravityPath(path);
+}
+
+// Widest path supported by the CPU we're running on:
+GravityPath GravityKernel::bestPath()
+{
+    #ifdef GRAVITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return GRAVITY_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return GRAVITY_SSE4;
+    #endif
+    return GRAVITY_SCALAR;
+}
+
+const char* GravityKernel::pathName(GravityPath npath)
+{
+    switch (npath)
+    {
+        case GRAVITY_AVX2: return "avx2";
+        case GRAVITY_SSE4: return "sse4";
+        default: return "scalar";
+    }
+}
+
+// Reference implementation, also used for the remainder of the vector
+// paths. Works on index[first] through index[count-1].
+void GravityKernel::scalar(const float* bx, const float* by,
+                           const int* index, int first, int count,
+                           const float* px, const float* py,
+                           const float* gm, int pCount,
+                           float* ax, float* ay)
+{
+    for (int i = first; i < count; ++i)
+    {
+        int b = index[i];
+        float sumX = 0.0f;
+        float sumY = 0.0f;
+        for (int p = 0; p < pCount; ++p)
+        {
+            float dx = px[p] - bx[b];
+            float dy = py[p] - by[b];
+            float sqrDis = dx*dx + dy*dy;
+            // A bullet sitting on a planet's center feels no pull from it:
+            if (0.0f >= sqrDis) continue;
+            float fg = gm[p]/(sqrDis*sqrtf(sqrDis));
+            sumX += fg*dx;
+            sumY += fg*dy;
+        }
+        ax[i] = sumX;
+        ay[i] = sumY;
+    }
+}
+
+#ifdef GRAVITY_X86
+__attribute__((target("sse4.1")))
+void GravityKernel::sse4(const float* bx, const float* by,
+                         const int* index, int count,
+                         const float* px, const float* py,
+                         const float* gm, int pCount,
+                         float* ax, float* ay)
+{
+    const __m128 zero = _mm_setzero_ps();
+    int i = 0;
+    for (; i+4 <= count; i += 4)
+    {
+        const int* idx = index+i;
+        __m128 x = _mm_set_ps(bx[idx[3]], bx[idx[2]], bx[idx[1]], bx[idx[0]]);
+        __m128 y = _mm_set_ps(by[idx[3]], by[idx[2]], by[idx[1]], by[idx[0]]);
+        __m128 sumX = zero;
+        __m128 sumY = zero;
+        for (int p = 0; p < pCount; ++p)
+        {
+            __m128 dx = _mm_sub_ps(_mm_set1_ps(px[p]), x);
+            __m128 dy = _mm_sub_ps(_mm_set1_ps(py[p]), y);
+            __m128 sqrDis = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            __m128 denom = _mm_mul_ps(sqrDis, _mm_sqrt_ps(sqrDis));
+            __m128 fg = _mm_div_ps(_mm_set1_ps(gm[p]), denom);
+            // Zero out lanes sitting on the planet's center:
+            fg = _mm_blendv_ps(zero, fg, _mm_cmpgt_ps(sqrDis, zero));
+            sumX = _mm_add_ps(sumX, _mm_mul_ps(fg, dx));
+            sumY = _mm_add_ps(sumY, _mm_mul_ps(fg, dy));
+        }
+        _mm_storeu_ps(ax+i, sumX);
+        _mm_storeu_ps(ay+i, sumY);
+    }
+    scalar(bx, by, index, i, count, px, py, gm, pCount, ax, ay);
+}
+
+__attribute__((target("avx2")))
+void GravityKernel::avx2(const float* bx, const float* by,
+                         const int* index, int count,
+                         const float* px, const float* py,
+                         const float* gm, int pCount,
+                         float* ax, float* ay)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    int i = 0;
+    for (; i+8 <= count; i += 8)
+    {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(index+i));
+        __m256 x = _mm256_i32gather_ps(bx, idx, 4);
+        __m256 y = _mm256_i32gather_ps(by, idx, 4);
+        __m256 sumX = zero;
+        __m256 sumY = zero;
+        for (int p = 0; p < pCount; ++p)
+        {
+            __m256 dx = _mm256_sub_ps(_mm256_set1_ps(px[p]), x);
+            __m256 dy = _mm256_sub_ps(_mm256_set1_ps(py[p]), y);
+            __m256 sqrDis = _mm256_add_ps(_mm256_mul_ps(dx, dx),
+                                          _mm256_mul_ps(dy, dy));
+            __m256 denom = _mm256_mul_ps(sqrDis, _mm256_sqrt_ps(sqrDis));
+            __m256 fg = _mm256_div_ps(_mm256_set1_ps(gm[p]), denom);
+            // Zero out lanes sitting on the planet's center:
+            fg = _mm256_and_ps(fg, _mm256_cmp_ps(sqrDis, zero, _CMP_GT_OQ));
+            sumX = _mm256_add_ps(sumX, _mm256_mul_ps(fg, dx));
+            sumY = _mm256_add_ps(sumY, _mm256_mul_ps(fg, dy));
+        }
+        _mm256_storeu_ps(ax+i, sumX);
+        _mm256_storeu_ps(ay+i, sumY);
+    }
+    scalar(bx, by, index, i, count, px, py, gm, pCount, ax, ay);
+}
+#else
+// Without x86 vector units both paths are the scalar loop:
+void GravityKernel::sse4(const float* bx, const float* by,
+                         const int* index, int count,
+                         const float* px, const float* py,
+                         const float* gm, int pCount,
+                         float* ax, float* ay)
+{
+    scalar(bx, by, index, 0, count, px, py, gm, pCount, ax, ay);
+}
+
+void GravityKernel::avx2(const float* bx, const float* by,
+                         const int* index, int count,
+                         const float* px, const float* py,
+                         const float* gm, int pCount,
+                         float* ax, float* ay)
+{
+    scalar(bx, by, index, 0, count, px, py, gm, pCount, ax, ay);
+}
+#endif
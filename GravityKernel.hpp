@@ -0,0 +1,59 @@
+// GravityKernel.hpp
+#ifndef GRAVITYKERNEL_HPP_
+#define GRAVITYKERNEL_HPP_
+#include "constants.hpp"
+
+// Implementations the kernel can dispatch to:
+enum GravityPath
+{
+    GRAVITY_SCALAR = 0,
+    GRAVITY_SSE4   = 1,
+    GRAVITY_AVX2   = 2
+};
+
+//-----------------------//
+// Gravity Kernel Class  //
+//-----------------------//
+// Sums the gravitational pull of every planet on a list of bullets.
+// The AVX2 path handles 8 bullets per instruction and the SSE4 path 4,
+// both falling back to the scalar loop for the remainder. The widest
+// path the CPU supports is picked the first time the kernel runs.
+//
+// Tolerance: the vector paths use the same single precision operations
+// as the scalar path but in a different order, so each component of a
+// result stays within GRAVITY_TOLERANCE*(sum of |contribution|) of the
+// scalar result.
+#define GRAVITY_TOLERANCE 1E-5
+
+class GravityKernel
+{
+public:
+    static void accumulate(const float* bx, const float* by,
+                           const int* index, int count,
+                           const float* px, const float* py,
+                           const float* gm, int pCount,
+                           float* ax, float* ay);
+    static GravityPath getPath();
+    static GravityPath setPath(GravityPath path);
+    static GravityPath bestPath();
+    static const char* pathName(GravityPath path);
+private:
+    static void scalar(const float* bx, const float* by,
+                       const int* index, int first, int count,
+                       const float* px, const float* py,
+                       const float* gm, int pCount,
+                       float* ax, float* ay);
+    static void sse4(const float* bx, const float* by,
+                     const int* index, int count,
+                     const float* px, const float* py,
+                     const float* gm, int pCount,
+                     float* ax, float* ay);
+    static void avx2(const float* bx, const float* by,
+                     const int* index, int count,
+                     const float* px, const float* py,
+                     const float* gm, int pCount,
+                     float* ax, float* ay);
+    static int path;    // -1 until the CPU has been queried
+};
+
+#endif
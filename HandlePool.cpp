@@ -0,0 +1,147 @@
+// HandlePool.cpp
+#include "HandlePool.hpp"
+
+// --PURPOSE--
+// Set up a pool.
+// --PARAMETERS--
+// icapacity:       Slots available before the pool has to grow.
+// imaxCapacity:    Most slots the pool may ever have, 0 for no limit.
+HandlePool::HandlePool(int icapacity, int imaxCapacity)
+{
+    this->maxCapacity = imaxCapacity;
+    this->freeHead = -1;
+    this->reserve(icapacity);
+}
+
+// Release every slot. Outstanding handles all become invalid.
+void HandlePool::clear()
+{
+    int cap = this->capacity();
+    this->freeHead = -1;
+    for (int s = cap-1; s >= 0; --s)
+    {
+        if (-1 != this->activeIndex[s]) ++this->generation[s];
+        this->activeIndex[s] = -1;
+        this->nextFree[s] = this->freeHead;
+        this->freeHead = s;
+    }
+    this->activeList.clear();
+}
+
+// Add slots until there are at least ncapacity of them. New slots are
+// put on the free list so the lowest index is handed out first.
+void HandlePool::reserve(int ncapacity)
+{
+    int cap = this->capacity();
+    if (0 != this->maxCapacity && ncapacity > this->maxCapacity)
+        ncapacity = this->maxCapacity;
+    if (ncapacity <= cap) return;
+
+    this->generation.resize(ncapacity, 0);
+    this->nextFree.resize(ncapacity, -1);
+    this->activeIndex.resize(ncapacity, -1);
+    for (int s = ncapacity-1; s >= cap; --s)
+    {
+        this->nextFree[s] = this->freeHead;
+        this->freeHead = s;
+    }
+}
+
+// --PURPOSE--
+// Double the capacity, within maxCapacity.
+// --RETURNS--
+// false if the pool is already as big as it may get.
+bool HandlePool::grow()
+{
+    int cap = this->capacity();
+    this->reserve((cap < 8) ? 16 : 2*cap);
+    return this->capacity() > cap;
+}
+
+bool HandlePool::hasFree() const
+{
+    return -1 != this->freeHead;
+}
+
+// --PURPOSE--
+// Take a slot off the free list. Doesn't grow the pool, so the owner can
+// resize its own arrays first.
+// --RETURNS--
+// A handle to the slot, with slot -1 if there are no free slots.
+handle HandlePool::allocate()
+{
+    handle h;
+    h.slot = this->freeHead;
+    h.generation = 0;
+    if (-1 == h.slot) return h;
+
+    this->freeHead = this->nextFree[h.slot];
+    this->nextFree[h.slot] = -1;
+    this->activeIndex[h.slot] = int(this->activeList.size());
+    this->activeList.push_back(h.slot);
+    h.generation = this->generation[h.slot];
+    return h;
+}
+
+// --PURPOSE--
+// Return a live slot to the free list. The last active slot is swapped
+// into its place in the active list, so callers walking the active list
+// while releasing should walk it backwards.
+bool HandlePool::release(int slot)
+{
+    if (!this->isAlive(slot)) return false;
+
+    int index = this->activeIndex[slot];
+    int last = this->activeList.back();
+    this->activeList[index] = last;
+    this->activeIndex[last] = index;
+    this->activeList.pop_back();
+    this->activeIndex[slot] = -1;
+
+    ++this->generation[slot];
+    this->nextFree[slot] = this->freeHead;
+    this->freeHead = slot;
+    return true;
+}
+
+bool HandlePool::release(handle h)
+{
+    return this->isValid(h) && this->release(h.slot);
+}
+
+bool HandlePool::isValid(handle h) const
+{
+    return this->isAlive(h.slot) && this->generation[h.slot] == h.generation;
+}
+
+bool HandlePool::isAlive(int slot) const
+{
+    return 0 <= slot && slot < this->capacity()
+        && -1 != this->activeIndex[slot];
+}
+
+// Handle to a slot that is currently alive:
+handle HandlePool::getHandle(int slot) const
+{
+    handle h;
+    h.slot = this->isAlive(slot) ? slot : -1;
+    h.generation = (-1 == h.slot) ? 0 : this->generation[slot];
+    return h;
+}
+
+int HandlePool::capacity() const
+{
+    return int(this->generation.size());
+}
+
+int HandlePool::count() const
+{
+    return int(this->activeList.size());
+}
+
+// Compacted list of live slots, valid for [0, count()) until the next
+// allocate or release:
+const int* HandlePool::active() const
+{
+    return this->activeList.empty() ? 0 : &this->activeList[0];
+}
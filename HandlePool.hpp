@@ -0,0 +1,49 @@
+// HandlePool.hpp
+#ifndef HANDLEPOOL_HPP_
+#define HANDLEPOOL_HPP_
+#include <vector>
+
+// Names a pool slot. The generation changes every time the slot is
+// released, so handles to dead entities stop validating instead of
+// silently pointing at whatever reused the slot.
+struct handle
+{
+    int slot;               // -1 for no slot
+    unsigned generation;
+};
+
+//-------------------//
+// Handle Pool Class //
+//-------------------//
+// Hands out slot indices for an entity pool. Free slots are kept in a
+// linked free list so allocating and releasing are O(1), and live slots
+// are kept in a compacted active list. The owner stores the entity data
+// itself and must resize its arrays whenever grow() succeeds.
+class HandlePool
+{
+public:
+    HandlePool(int icapacity = 0, int imaxCapacity = 0);
+    void clear();
+    bool grow();
+    void reserve(int ncapacity);
+    bool hasFree() const;
+    handle allocate();
+    bool release(int slot);
+    bool release(handle h);
+    bool isValid(handle h) const;
+    bool isAlive(int slot) const;
+    handle getHandle(int slot) const;
+    int capacity() const;
+    int count() const;
+    const int* active() const;
+
+    int maxCapacity;    // 0 lets the pool grow without limit
+private:
+    std::vector<unsigned> generation;
+    std::vector<int> nextFree;      // free list links, -1 ends it
+    std::vector<int> activeIndex;   // slot -> position in activeList, or -1
+    std::vector<int> activeList;
+    int freeHead;
+};
+
+#endif
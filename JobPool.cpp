@@ -0,0 +1,156 @@
+// JobPool.cpp
+#include "JobPool.hpp"
+
+// --PURPOSE--
+// Start the worker threads.
+// --PARAMETERS--
+// workers: Number of worker threads besides the caller. -1 uses one
+//          per remaining core.
+JobPool::JobPool(int workers)
+{
+    if (0 > workers)
+    {
+        int cores = int(std::thread::hardware_concurrency());
+        workers = (cores > 1) ? cores-1 : 0;
+    }
+
+    this->remaining = 0;
+    this->batch = 0;
+    this->quit = false;
+    for (int w = 0; w <= workers; ++w)
+    {
+        this->queues.push_back(new queue);
+        this->queues.back()->head = 0;
+    }
+    for (int w = 0; w < workers; ++w)
+        this->threads.push_back(std::thread(&JobPool::workerLoop, this, w));
+}
+
+// Destructor:
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->wakeLock);
+        this->quit = true;
+    }
+    this->wake.notify_all();
+    for (size_t t = 0; t < this->threads.size(); ++t)
+        this->threads[t].join();
+    for (size_t q = 0; q < this->queues.size(); ++q)
+        delete this->queues[q];
+}
+
+// Number of threads that run chunks, including the caller:
+int JobPool::threadCount() const
+{
+    return int(this->queues.size());
+}
+
+// --PURPOSE--
+// Run fn(context, begin, end) over [0, count) split into chunks of
+// chunkSize, and wait for all of them. Chunks may run in any order on
+// any thread, so fn must only write to data owned by its own range.
+void JobPool::parallelFor(int count, int chunkSize, task fn,
+                          const void* context)
+{
+    if (0 >= count) return;
+    if (0 >= chunkSize) chunkSize = 1;
+
+    // Not worth waking anybody for a single chunk:
+    int chunks = (count+chunkSize-1)/chunkSize;
+    if (1 == chunks || 1 == this->threadCount())
+    {
+        fn(context, 0, count);
+        return;
+    }
+
+    // Deal the chunks out round-robin:
+    this->remaining = chunks;
+    int qCount = this->threadCount();
+    for (int c = 0; c < chunks; ++c)
+    {
+        chunk ch;
+        ch.begin = c*chunkSize;
+        ch.end = (ch.begin+chunkSize < count) ? ch.begin+chunkSize : count;
+        ch.fn = fn;
+        ch.context = context;
+        queue* q = this->queues[c%qCount];
+        std::lock_guard<std::mutex> guard(q->lock);
+        q->chunks.push_back(ch);
+    }
+    {
+        std::lock_guard<std::mutex> guard(this->wakeLock);
+        ++this->batch;
+    }
+    this->wake.notify_all();
+
+    // Help out, then wait for chunks still running elsewhere:
+    chunk ch;
+    int self = qCount-1;
+    while (popOrSteal(self, ch))
+    {
+        ch.fn(ch.context, ch.begin, ch.end);
+        --this->remaining;
+    }
+    while (0 < this->remaining) std::this_thread::yield();
+}
+
+// Take a chunk from the back of our own queue, or from the front of
+// somebody else's.
+bool JobPool::popOrSteal(int self, chunk& c)
+{
+    {
+        queue* q = this->queues[self];
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (q->head < q->chunks.size())
+        {
+            c = q->chunks.back();
+            q->chunks.pop_back();
+            if (q->head == q->chunks.size()) drain(q);
+            return true;
+        }
+    }
+
+    int qCount = this->threadCount();
+    for (int i = 1; i < qCount; ++i)
+    {
+        queue* q = this->queues[(self+i)%qCount];
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (q->head < q->chunks.size())
+        {
+            c = q->chunks[q->head++];
+            if (q->head == q->chunks.size()) drain(q);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Empty a queue whose chunks have all been taken. Locked by the caller:
+void JobPool::drain(queue* q)
+{
+    q->chunks.clear();
+    q->head = 0;
+}
+
+void JobPool::workerLoop(int self)
+{
+    unsigned seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(this->wakeLock);
+            while (!this->quit && seen == this->batch)
+                this->wake.wait(guard);
+            if (this->quit) return;
+            seen = this->batch;
+        }
+
+        chunk ch;
+        while (popOrSteal(self, ch))
+        {
+            ch.fn(ch.context, ch.begin, ch.end);
+            --this->remaining;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+// JobPool.hpp
+#ifndef JOBPOOL_HPP_
+#define JOBPOOL_HPP_
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//----------------//
+// Job Pool Class //
+//----------------//
+// One worker thread per core, each with its own queue of chunks. A
+// worker drains its own queue from the back and, once empty, steals
+// from the front of the others. The thread that submits the work helps
+// out and returns once every chunk has run. Only one thread may call
+// parallelFor at a time. The work is passed by pointer, never copied
+// or wrapped, so running it doesn't allocate.
+class JobPool
+{
+public:
+    // fn(context, begin, end), see parallelFor:
+    typedef void (*task)(const void*, int, int);
+
+    JobPool(int workers = -1);
+    ~JobPool();
+    template <typename F>
+    void parallelFor(int count, int chunkSize, const F& fn);
+    void parallelFor(int count, int chunkSize, task fn, const void* context);
+    int threadCount() const;
+private:
+    struct chunk
+    {
+        int begin, end;
+        task fn;
+        const void* context;
+    };
+    // Chunks are only added while the queue is idle, so the live ones are
+    // chunks[head] on. Cleared once drained, keeping its capacity:
+    struct queue
+    {
+        std::mutex lock;
+        std::vector<chunk> chunks;
+        size_t head;
+    };
+
+    void workerLoop(int self);
+    bool popOrSteal(int self, chunk& c);
+    static void drain(queue* q);
+
+    std::vector<queue*> queues;     // one per worker, the last is the caller's
+    std::vector<std::thread> threads;
+    std::atomic<int> remaining;     // chunks of the current batch not yet run
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    unsigned batch;                 // bumped for every parallelFor call
+    bool quit;
+};
+
+// --PURPOSE--
+// Run fn(begin, end) over [0, count) split into chunks of chunkSize,
+// and wait for all of them. fn is any callable, e.g. a lambda; it stays
+// where it is and is called through a pointer.
+template <typename F>
+void JobPool::parallelFor(int count, int chunkSize, const F& fn)
+{
+    struct call
+    {
+        static void run(const void* context, int begin, int end)
+        {
+            (*static_cast<const F*>(context))(begin, end);
+        }
+    };
+    this->parallelFor(count, chunkSize, &call::run, &fn);
+}
+
+#endif
@@ -0,0 +1,102 @@
+// Scenario.cpp
+#include "Scenario.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Uniform random float in [lo, hi]:
+static float randRange(float lo, float hi)
+{
+    return lo + (hi-lo)*(float(rand())/RAND_MAX);
+}
+
+// --PURPOSE--
+// Clear the world and fill it from a scenario file.
+// --RETURNS--
+// false if the file can't be read or has a line that doesn't parse.
+bool loadScenario(const char *fileName, World& world)
+{
+    FILE *fp;
+
+    // open file and check if it was successful
+    if (NULL == (fp = fopen(fileName, "r")))
+    {
+        fprintf(stderr, "%s: No such file\n", fileName);
+        return false;
+    }
+
+    world.clear();
+    char line[256];
+    int lineNum = 0;
+    bool ok = true;
+    while (ok && NULL != fgets(line, sizeof(line), fp))
+    {
+        ++lineNum;
+        // Strip comments:
+        char *hash = strchr(line, '#');
+        if (NULL != hash) *hash = '\0';
+
+        char cmd[32];
+        float a[5];
+        if (1 != sscanf(line, "%31s", cmd)) continue;
+        const char *args = strstr(line, cmd)+strlen(cmd);
+        int n = sscanf(args, "%f %f %f %f %f", &a[0], &a[1], &a[2], &a[3], &a[4]);
+
+        if (0 == strcmp(cmd, "size") && 2 == n)
+        {
+            world.width = a[0];
+            world.height = a[1];
+        }
+        else if (0 == strcmp(cmd, "capacity") && 2 == n)
+        {
+            world.reserve(int(a[0]), int(a[1]));
+        }
+        else if (0 == strcmp(cmd, "field") && 1 == n)
+        {
+            world.useGravityField = (0.0f != a[0]);
+        }
+        else if (0 == strcmp(cmd, "exact") && 1 == n)
+        {
+            world.exactCollision = (0.0f != a[0]);
+        }
+        else if (0 == strcmp(cmd, "craters") && 1 == n)
+        {
+            world.craters = (0.0f != a[0]);
+        }
+        else if (0 == strcmp(cmd, "seed") && 1 == n)
+        {
+            srand(unsigned(a[0]));
+        }
+        else if (0 == strcmp(cmd, "planet") && n >= 2 && n <= 4)
+        {
+            glm::vec2 pos = glm::vec2(a[0], a[1]);
+            int p = world.addPlanet(pos).slot;
+            if (-1 != p && n >= 3) world.planets[p].changePlanetGraphic(a[2]);
+            if (-1 != p && n >= 4) world.planets[p].rotSpeed = a[3];
+        }
+        else if (0 == strcmp(cmd, "bullet") && (2 == n || 4 == n))
+        {
+            glm::vec2 vel = (4 == n) ? glm::vec2(a[2], a[3]) : glm::vec2(0.0f);
+            world.addBullet(glm::vec2(a[0], a[1]), vel);
+        }
+        else if (0 == strcmp(cmd, "bullets") && 5 == n)
+        {
+            for (int b = 0; b < int(a[0]); ++b)
+            {
+                glm::vec2 pos = glm::vec2(randRange(a[1], a[3]),
+                                          randRange(a[2], a[4]));
+                world.addBullet(pos, glm::vec2(0.0f));
+            }
+        }
+        else
+        {
+            fprintf(stderr, "%s:%d: can't parse \"%s\"\n",
+                    fileName, lineNum, cmd);
+            ok = false;
+        }
+    }
+
+    // close file
+    fclose(fp);
+    return ok;
+}
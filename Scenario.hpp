@@ -0,0 +1,19 @@
+// Scenario.hpp
+#ifndef SCENARIO_HPP_
+#define SCENARIO_HPP_
+#include "World.hpp"
+
+// Scenario files are plain text, one command per line, '#' for comments:
+//   size <width> <height>                  play area
+//   capacity <bullets> <planets>           pool sizes to start with
+//   field <0|1>                            cached planet gravity off/on
+//   exact <0|1>                            collide with the outlines, not
+//                                          the distance fields
+//   craters <0|1>                          landed bullets dig into planets
+//   seed <n>                               seeds rand() for what follows
+//   planet <x> <y> [maxRad [rotSpeed]]     random where not given
+//   bullet <x> <y> [vx vy]
+//   bullets <n> <x0> <y0> <x1> <y1>        n bullets at rest in a box
+bool loadScenario(const char *fileName, World& world);
+
+#endif
@@ -0,0 +1,232 @@
+// SimThread.cpp
+#include "SimThread.hpp"
+#include <cmath>
+
+// --PURPOSE--
+// Set up the thread for a world, without starting it.
+SimThread::SimThread(World& iworld) : world(iworld)
+{
+    this->running = false;
+    this->back = 0;
+    this->middle = 1;
+    this->front = 2;
+}
+
+// Destructor:
+SimThread::~SimThread()
+{
+    this->stop();
+}
+
+// --PURPOSE--
+// Publish the world as it is, then start stepping it. From here on,
+// only the simulation thread may touch the world.
+void SimThread::start()
+{
+    if (this->running) return;
+    this->recordPrevious();
+    this->publish();
+    this->running = true;
+    this->thread = std::thread(&SimThread::run, this);
+}
+
+// Finish the current tick and stop. Queued commands are kept.
+void SimThread::stop()
+{
+    if (!this->running) return;
+    this->running = false;
+    this->thread.join();
+}
+
+// --PURPOSE--
+// Queue a change to the world, e.g. from input. Commands run on the
+// simulation thread, in the order posted, at the start of the next tick.
+void SimThread::post(const command& cmd)
+{
+    std::lock_guard<std::mutex> guard(this->inputLock);
+    this->pending.push_back(cmd);
+}
+
+// --PURPOSE--
+// Ask for shots to be previewed with World::previewShots after every
+// tick, into the snapshot's preview. A count of 0 stops previewing.
+void SimThread::setPreview(const glm::vec2* pos, const glm::vec2* vel,
+                           int count)
+{
+    std::lock_guard<std::mutex> guard(this->inputLock);
+    this->previewPos.assign(pos, pos+count);
+    this->previewVel.assign(vel, vel+count);
+}
+
+// --PURPOSE--
+// The newest snapshot published. Only one thread may call this.
+// --RETURNS--
+// A snapshot that stays untouched until the next call.
+const SimThread::snapshot& SimThread::latest()
+{
+    if (this->middle.load(std::memory_order_acquire) & SNAPSHOT_FRESH)
+        this->front = this->middle.exchange(this->front,
+                                            std::memory_order_acq_rel) & 3;
+    return this->buffers[this->front];
+}
+
+// --PURPOSE--
+// How far a renderer drawing at a given time is between a snapshot's
+// previous and current positions.
+// --RETURNS--
+// 0 right when the snapshot was published, up to 1 a whole step later.
+float SimThread::blend(const snapshot& snap, clock::time_point now)
+{
+    if (0.0f >= snap.stepDt) return 1.0f;
+    float t = std::chrono::duration<float>(now-snap.published).count()
+              /snap.stepDt;
+    return (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+}
+
+// Tick at the world's rate until stopped. A tick that runs long makes
+// the next ones start late, but after falling MAX_SIM_STEPS behind the
+// lost time is dropped, so a stall can't snowball.
+void SimThread::run()
+{
+    clock::time_point next = clock::now();
+    while (this->running)
+    {
+        this->tick();
+
+        clock::duration dt = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(this->world.stepDt));
+        next += dt;
+        clock::time_point now = clock::now();
+        if (now-next > MAX_SIM_STEPS*dt) next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void SimThread::tick()
+{
+    this->takeCommands();
+    for (size_t c = 0; c < this->taken.size(); ++c) this->taken[c](this->world);
+    this->taken.clear();
+
+    this->recordPrevious();
+    this->world.step();
+    // Landed bullets are drawn through DebugDraw, if at all:
+    this->world.impacts.clear();
+
+    int shots = int(this->shotPos.size());
+    snapshot& snap = this->buffers[this->back];
+    if (0 < shots)
+        this->world.previewShots(&this->shotPos[0], &this->shotVel[0],
+                                 shots, PREVIEW_STEPS, PREVIEW_STRIDE,
+                                 snap.preview);
+    else snap.preview.clear();
+    this->publish();
+}
+
+// Move what other threads sent over to the simulation thread's side:
+void SimThread::takeCommands()
+{
+    std::lock_guard<std::mutex> guard(this->inputLock);
+    this->taken.swap(this->pending);
+    this->shotPos = this->previewPos;
+    this->shotVel = this->previewVel;
+}
+
+// Where everything is before a tick, by slot:
+void SimThread::recordPrevious()
+{
+    const BulletPool& bullets = this->world.bullets;
+    int cap = bullets.capacity();
+    if (int(this->lastX.size()) < cap)
+    {
+        this->lastX.resize(cap);
+        this->lastY.resize(cap);
+        this->lastStart.resize(cap, -1.0f);
+    }
+    for (int i = 0; i < bullets.count(); ++i)
+    {
+        int b = bullets.active()[i];
+        this->lastX[b] = bullets.posX[b];
+        this->lastY[b] = bullets.posY[b];
+        this->lastStart[b] = bullets.startTime[b];
+    }
+
+    int planets = int(this->world.planets.size());
+    this->lastPos.resize(planets);
+    this->lastOrient.resize(planets);
+    this->lastMesh.resize(planets, 0);
+    for (int p = 0; p < planets; ++p)
+    {
+        const planet& pl = this->world.planets[p];
+        this->lastPos[p] = pl.pos;
+        this->lastOrient[p] = pl.orient;
+        this->lastMesh[p] = pl.meshVersion;
+    }
+}
+
+// Fill the back buffer from the world and swap it into the middle. A
+// bullet or planet that wasn't in the same slot before the tick starts
+// where it is now. Planet outlines are only copied when the buffer's
+// copy is older than the planet's mesh or edits, which is rare, since
+// each buffer comes back around every third tick.
+void SimThread::publish()
+{
+    snapshot& snap = this->buffers[this->back];
+    snap.ticks = this->world.ticks;
+    snap.simTime = this->world.simTime;
+    snap.stepDt = this->world.stepDt;
+
+    const BulletPool& bullets = this->world.bullets;
+    int count = bullets.count();
+    snap.posX.resize(count);
+    snap.posY.resize(count);
+    snap.prevX.resize(count);
+    snap.prevY.resize(count);
+    snap.rad.resize(count);
+    snap.color.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        int b = bullets.active()[i];
+        bool same = b < int(this->lastStart.size())
+                    && this->lastStart[b] == bullets.startTime[b];
+        snap.posX[i] = bullets.posX[b];
+        snap.posY[i] = bullets.posY[b];
+        snap.prevX[i] = same ? this->lastX[b] : bullets.posX[b];
+        snap.prevY[i] = same ? this->lastY[b] : bullets.posY[b];
+        snap.rad[i] = bullets.rad[b];
+        snap.color[i] = bullets.color[b];
+    }
+
+    int planets = int(this->world.planets.size());
+    snap.planets.resize(planets);
+    for (int p = 0; p < planets; ++p)
+    {
+        const planet& pl = this->world.planets[p];
+        planetView& view = snap.planets[p];
+        const float* data = pl.getPlanetData();
+        bool held = view.alive;
+        view.alive = (NULL != data && 0.0f < pl.maxRad);
+        if (!view.alive) continue;
+
+        bool same = p < int(this->lastMesh.size())
+                    && this->lastMesh[p] == pl.meshVersion;
+        view.pos = pl.pos;
+        view.prevPos = same ? this->lastPos[p] : pl.pos;
+        view.orient = pl.orient;
+        view.prevOrient = same ? this->lastOrient[p] : pl.orient;
+        view.color = pl.color;
+        if (held && view.meshVersion == pl.meshVersion
+            && view.editVersion == pl.editVersion) continue;
+
+        view.meshVersion = pl.meshVersion;
+        view.editVersion = pl.editVersion;
+        for (int k = 0; k < 2*NUM_PLANET_VERTS+4; ++k)
+            view.outline[k] = data[k];
+        for (int k = 0; k < NUM_PLANET_VERTS+2; ++k)
+            view.vertexEdits[k] = pl.getEditVersion(k);
+    }
+
+    snap.published = clock::now();
+    this->back = this->middle.exchange(this->back | SNAPSHOT_FRESH,
+                                       std::memory_order_acq_rel) & 3;
+}
@@ -0,0 +1,116 @@
+// SimThread.hpp
+#ifndef SIMTHREAD_HPP_
+#define SIMTHREAD_HPP_
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "constants.hpp"
+#include "World.hpp"
+
+//-------------------------//
+// Simulation Thread Class //
+//-------------------------//
+// Steps a World at its fixed rate on a thread of its own, so a slow
+// tick never holds up a frame and a slow frame never holds up physics.
+// Once started, the world belongs to the thread: other threads change
+// it only through post(), and see it only through snapshots. Each tick
+// publishes a snapshot of everything drawn, with where things were
+// before the tick too, so the renderer can blend between the two at
+// any display rate. Snapshots are triple buffered and handed over with
+// one atomic exchange, so neither side ever waits on the other.
+#define SNAPSHOT_FRESH 4    // flag on the middle buffer index
+
+class SimThread
+{
+public:
+    typedef std::function<void(World&)> command;
+    typedef std::chrono::steady_clock clock;
+
+    // A planet as the renderer needs it, by slot:
+    struct planetView
+    {
+        bool alive;         // has data and a radius
+        glm::vec2 pos;
+        glm::vec2 prevPos;  // before the tick
+        float orient;
+        float prevOrient;
+        glm::vec3 color;
+        unsigned meshVersion;
+        unsigned editVersion;
+        float outline[2*NUM_PLANET_VERTS+4];        // the planet data
+        unsigned vertexEdits[NUM_PLANET_VERTS+2];   // see planet::editedSince
+
+        bool editedSince(int slot, unsigned since) const
+        {
+            return this->vertexEdits[slot] > since;
+        }
+    };
+
+    // The world after one tick:
+    struct snapshot
+    {
+        long ticks;
+        double simTime;
+        float stepDt;
+        clock::time_point published;
+        std::vector<planetView> planets;
+        // Live bullets, before the tick in prevX and prevY:
+        std::vector<float> posX;
+        std::vector<float> posY;
+        std::vector<float> prevX;
+        std::vector<float> prevY;
+        std::vector<float> rad;
+        std::vector<glm::vec3> color;
+        std::vector<World::trajectory> preview;     // see setPreview
+    };
+
+    SimThread(World& iworld);
+    ~SimThread();
+    void start();
+    void stop();
+    void post(const command& cmd);
+    void setPreview(const glm::vec2* pos, const glm::vec2* vel, int count);
+    const snapshot& latest();
+    static float blend(const snapshot& snap, clock::time_point now);
+private:
+    void run();
+    void tick();
+    void takeCommands();
+    void recordPrevious();
+    void publish();
+
+    World& world;
+    std::thread thread;
+    std::atomic<bool> running;
+
+    // Commands and the preview request, guarded by inputLock:
+    std::mutex inputLock;
+    std::vector<command> pending;
+    std::vector<glm::vec2> previewPos;
+    std::vector<glm::vec2> previewVel;
+
+    // Simulation thread only:
+    std::vector<command> taken;
+    std::vector<glm::vec2> shotPos;
+    std::vector<glm::vec2> shotVel;
+    std::vector<float> lastX;           // bullet positions before the tick,
+    std::vector<float> lastY;           // by slot
+    std::vector<float> lastStart;       // startTime of the bullet they belong to
+    std::vector<glm::vec2> lastPos;     // the same for planets
+    std::vector<float> lastOrient;
+    std::vector<unsigned> lastMesh;
+
+    // Triple buffer: back is written by the simulation, front is read by
+    // the renderer, and middle holds the one in between, flagged with
+    // SNAPSHOT_FRESH when the simulation has put a newer one there.
+    snapshot buffers[3];
+    std::atomic<int> middle;
+    int back;
+    int front;
+};
+
+#endif
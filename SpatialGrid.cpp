@@ -0,0 +1,160 @@
+// SpatialGrid.cpp
+#include "SpatialGrid.hpp"
+#include <cmath>
+
+// Default constructor:
+SpatialGrid::SpatialGrid()
+{
+    this->cellSize = 1.0f;
+    this->minX = 0.0f;
+    this->minY = 0.0f;
+    this->invCell = 1.0f;
+    this->cols = 0;
+    this->rows = 0;
+}
+
+int SpatialGrid::cellCount() const
+{
+    return this->cols*this->rows;
+}
+
+// --PURPOSE--
+// Rebuild the grid over a new set of circles. Cells are about as wide
+// as an average circle, so most circles land in a handful of cells.
+// --PARAMETERS--
+// x, y:    Circle centers.
+// rad:     Circle radii.
+// count:   Number of circles. Queries report indices into these arrays.
+void SpatialGrid::build(const float* x, const float* y, const float* rad,
+                        int count)
+{
+    this->cols = 0;
+    this->rows = 0;
+    this->cellStart.clear();
+    this->cellItems.clear();
+    this->itemCol.resize(count);
+    this->itemRow.resize(count);
+    if (0 == count) return;
+
+    // Box that bounds every circle:
+    float maxX = x[0]+rad[0], maxY = y[0]+rad[0];
+    float radSum = 0.0f;
+    this->minX = x[0]-rad[0];
+    this->minY = y[0]-rad[0];
+    for (int i = 0; i < count; ++i)
+    {
+        if (x[i]-rad[i] < this->minX) this->minX = x[i]-rad[i];
+        if (y[i]-rad[i] < this->minY) this->minY = y[i]-rad[i];
+        if (x[i]+rad[i] > maxX) maxX = x[i]+rad[i];
+        if (y[i]+rad[i] > maxY) maxY = y[i]+rad[i];
+        radSum += rad[i];
+    }
+
+    // Cells one average diameter wide, but never more than GRID_MAX_CELLS:
+    float w = maxX - this->minX;
+    float h = maxY - this->minY;
+    this->cellSize = 2.0f*radSum/count;
+    if (this->cellSize <= TOL) this->cellSize = 1.0f;
+    if (w*h > GRID_MAX_CELLS*this->cellSize*this->cellSize)
+        this->cellSize = sqrtf(w*h/GRID_MAX_CELLS);
+    this->invCell = 1.0f/this->cellSize;
+    this->cols = int(w*this->invCell)+1;
+    this->rows = int(h*this->invCell)+1;
+
+    // Count the circles in each cell, then turn the counts into offsets:
+    int cells = this->cols*this->rows;
+    this->cellStart.assign(cells+1, 0);
+    for (int i = 0; i < count; ++i)
+    {
+        int c0, r0, c1, r1;
+        cellRange(x[i]-rad[i], y[i]-rad[i], x[i]+rad[i], y[i]+rad[i],
+                  &c0, &r0, &c1, &r1);
+        this->itemCol[i] = c0;
+        this->itemRow[i] = r0;
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                ++this->cellStart[r*this->cols+c+1];
+    }
+    for (int c = 0; c < cells; ++c)
+        this->cellStart[c+1] += this->cellStart[c];
+
+    // Fill the cells in index order, so each cell's list is sorted:
+    this->fill.assign(this->cellStart.begin(), this->cellStart.end()-1);
+    this->cellItems.resize(this->cellStart[cells]);
+    for (int i = 0; i < count; ++i)
+    {
+        int c0, r0, c1, r1;
+        cellRange(x[i]-rad[i], y[i]-rad[i], x[i]+rad[i], y[i]+rad[i],
+                  &c0, &r0, &c1, &r1);
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                this->cellItems[this->fill[r*this->cols+c]++] = i;
+    }
+}
+
+// Cells under a box, clamped to the grid:
+void SpatialGrid::cellRange(float x0, float y0, float x1, float y1,
+                            int* c0, int* r0, int* c1, int* r1) const
+{
+    *c0 = int(floorf((x0-this->minX)*this->invCell));
+    *r0 = int(floorf((y0-this->minY)*this->invCell));
+    *c1 = int(floorf((x1-this->minX)*this->invCell));
+    *r1 = int(floorf((y1-this->minY)*this->invCell));
+    if (*c0 < 0) *c0 = 0;
+    if (*r0 < 0) *r0 = 0;
+    if (*c1 >= this->cols) *c1 = this->cols-1;
+    if (*r1 >= this->rows) *r1 = this->rows-1;
+}
+
+// --PURPOSE--
+// Find the circles whose bounding boxes share a cell with a box.
+// A circle spanning several of those cells is reported only from the
+// first one, so the results are unique without any bookkeeping.
+// --PARAMETERS--
+// x0, y0, x1, y1:  Corners of the box, x0 <= x1 and y0 <= y1.
+// out:             Receives up to maxOut indices, in ascending order.
+// --RETURNS--
+// The number of circles found, which may be more than maxOut.
+int SpatialGrid::query(float x0, float y0, float x1, float y1,
+                       int* out, int maxOut) const
+{
+    if (0 == this->cols) return 0;
+    // Quick reject for boxes off the grid:
+    float maxX = this->minX + this->cols*this->cellSize;
+    float maxY = this->minY + this->rows*this->cellSize;
+    if (x1 < this->minX || y1 < this->minY || x0 > maxX || y0 > maxY)
+        return 0;
+
+    int c0, r0, c1, r1;
+    cellRange(x0, y0, x1, y1, &c0, &r0, &c1, &r1);
+
+    int found = 0;
+    for (int r = r0; r <= r1; ++r)
+    {
+        for (int c = c0; c <= c1; ++c)
+        {
+            int cell = r*this->cols+c;
+            for (int k = this->cellStart[cell]; k < this->cellStart[cell+1]; ++k)
+            {
+                int i = this->cellItems[k];
+                int firstCol = (this->itemCol[i] > c0) ? this->itemCol[i] : c0;
+                int firstRow = (this->itemRow[i] > r0) ? this->itemRow[i] : r0;
+                if (c != firstCol || r != firstRow) continue;
+
+                // Insertion keeps the output sorted:
+                if (found < maxOut)
+                {
+                    int j = found;
+                    while (j > 0 && out[j-1] > i)
+                    {
+                        out[j] = out[j-1];
+                        --j;
+                    }
+                    out[j] = i;
+                }
+                ++found;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,39 @@
+// SpatialGrid.hpp
+#ifndef SPATIALGRID_HPP_
+#define SPATIALGRID_HPP_
+#include <vector>
+#include "constants.hpp"
+
+//--------------------//
+// Spatial Grid Class //
+//--------------------//
+// Uniform grid over a set of circles, used as the broad phase between
+// bullets and planets. Each cell lists the circles whose bounding boxes
+// overlap it, so a query only looks at the cells under its own box
+// instead of at every circle.
+class SpatialGrid
+{
+public:
+    SpatialGrid();
+    void build(const float* x, const float* y, const float* rad,
+               int count);
+    int query(float x0, float y0, float x1, float y1,
+              int* out, int maxOut) const;
+    int cellCount() const;
+
+    float cellSize;     // picked by build()
+private:
+    void cellRange(float x0, float y0, float x1, float y1,
+                   int* c0, int* r0, int* c1, int* r1) const;
+
+    float minX, minY;
+    float invCell;
+    int cols, rows;
+    std::vector<int> cellStart;     // cell c owns items [cellStart[c], cellStart[c+1])
+    std::vector<int> cellItems;
+    std::vector<int> fill;          // next free spot in each cell, while building
+    std::vector<int> itemCol;       // first cell column of each item's box
+    std::vector<int> itemRow;       // first cell row of each item's box
+};
+
+#endif
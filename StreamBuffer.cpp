@@ -0,0 +1,184 @@
+// StreamBuffer.cpp
+#include "StreamBuffer.hpp"
+#include <cstdio>
+
+// Default constructor, nothing is allocated until create():
+StreamBuffer::StreamBuffer()
+{
+    this->vbo = 0;
+    this->bufferVersion = 0;
+    this->segmentSize = 0;
+    this->segment = 0;
+    this->used = 0;
+    this->pending = 0;
+    for (int s = 0; s < STREAM_SEGMENTS; ++s) this->fences[s] = 0;
+    this->mapped = NULL;
+}
+
+// --PURPOSE--
+// Allocate the ring. Needs a current GL context.
+// --PARAMETERS--
+// isegmentSize:    Bytes each frame may write before the ring has to
+//                  grow, which costs a new buffer.
+// --RETURNS--
+// false if the buffer couldn't be made.
+bool StreamBuffer::create(GLsizeiptr isegmentSize)
+{
+    this->destroy();
+    this->segmentSize = isegmentSize;
+    return this->allocateStorage();
+}
+
+// Make the buffer, STREAM_SEGMENTS segments long. It is bound to
+// GL_COPY_WRITE_BUFFER only, so whatever the renderer has bound to
+// GL_ARRAY_BUFFER stays put.
+bool StreamBuffer::allocateStorage()
+{
+    GLsizeiptr total = STREAM_SEGMENTS*this->segmentSize;
+    glGenBuffers(1, &this->vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->vbo);
+    this->mapped = NULL;
+    if (GLEW_ARB_buffer_storage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                         | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+        this->mapped = (GLubyte*)glMapBufferRange(GL_COPY_WRITE_BUFFER,
+                                                  0, total, flags);
+        if (NULL == this->mapped)
+        {
+            // Immutable storage can't be respecified, start over:
+            glDeleteBuffers(1, &this->vbo);
+            glGenBuffers(1, &this->vbo);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, this->vbo);
+        }
+    }
+    if (NULL == this->mapped)
+        glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    ++this->bufferVersion;
+    this->used = 0;
+    this->pending = 0;
+    if (0 == this->vbo)
+    {
+        fprintf(stderr, "StreamBuffer: could not create a buffer\n");
+        return false;
+    }
+    return true;
+}
+
+// Free the buffer and fences. Draws already issued keep their data.
+void StreamBuffer::destroy()
+{
+    for (int s = 0; s < STREAM_SEGMENTS; ++s)
+    {
+        if (0 != this->fences[s]) glDeleteSync(this->fences[s]);
+        this->fences[s] = 0;
+    }
+    // Deleting a mapped buffer unmaps it:
+    if (0 != this->vbo) glDeleteBuffers(1, &this->vbo);
+    this->vbo = 0;
+    this->mapped = NULL;
+    this->used = 0;
+    this->pending = 0;
+}
+
+// Wait until the GPU is done with this frame's segment. With
+// STREAM_SEGMENTS frames in the ring it almost always already is.
+void StreamBuffer::beginFrame()
+{
+    this->waitSegment(this->segment);
+    this->used = 0;
+    this->pending = 0;
+}
+
+// Fence the segment behind the draws issued this frame and move on:
+void StreamBuffer::endFrame()
+{
+    if (0 == this->vbo) return;
+    this->fences[this->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,
+                                              0);
+    this->segment = (this->segment+1)%STREAM_SEGMENTS;
+}
+
+void StreamBuffer::waitSegment(int s)
+{
+    if (0 == this->fences[s]) return;
+    GLenum status;
+    do
+    {
+        status = glClientWaitSync(this->fences[s],
+                                  GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  STREAM_WAIT_NS);
+    } while (GL_TIMEOUT_EXPIRED == status);
+    glDeleteSync(this->fences[s]);
+    this->fences[s] = 0;
+}
+
+// --PURPOSE--
+// Room for the next write. If this frame's segment is full, the ring is
+// replaced by one with segments at least twice as big; the old buffer
+// lives on until the draws that read it are done.
+// --PARAMETERS--
+// floats:  Number of floats to be written.
+// --RETURNS--
+// Where to write them, valid until commit().
+GLfloat* StreamBuffer::allocate(int floats)
+{
+    GLsizeiptr bytes = sizeof(GLfloat)*floats;
+    // Keep every write aligned for any vertex format:
+    this->used = (this->used+15) & ~GLsizeiptr(15);
+    if (this->used+bytes > this->segmentSize)
+    {
+        GLsizeiptr size = 2*this->segmentSize;
+        while (size < bytes) size *= 2;
+        this->destroy();
+        this->segmentSize = size;
+        this->allocateStorage();
+    }
+
+    this->pending = bytes;
+    if (NULL != this->mapped)
+        return (GLfloat*)(this->mapped
+                          +this->segment*this->segmentSize+this->used);
+    if (int(this->staging.size()) < floats) this->staging.resize(floats);
+    return &this->staging[0];
+}
+
+// --PURPOSE--
+// Finish the last allocate(). Without a persistent mapping, this is
+// where the data is uploaded.
+// --RETURNS--
+// Byte offset of the data in buffer().
+GLintptr StreamBuffer::commit()
+{
+    GLintptr offset = this->segment*this->segmentSize+this->used;
+    if (NULL == this->mapped && 0 != this->pending)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, this->vbo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, this->pending,
+                        &this->staging[0]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    this->used += this->pending;
+    this->pending = 0;
+    return offset;
+}
+
+GLuint StreamBuffer::buffer() const
+{
+    return this->vbo;
+}
+
+// Changes whenever buffer() does, so vertex arrays that point into it
+// know to be pointed again:
+unsigned StreamBuffer::version() const
+{
+    return this->bufferVersion;
+}
+
+bool StreamBuffer::persistent() const
+{
+    return NULL != this->mapped;
+}
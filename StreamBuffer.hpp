@@ -0,0 +1,50 @@
+// StreamBuffer.hpp
+#ifndef STREAMBUFFER_HPP_
+#define STREAMBUFFER_HPP_
+#include <vector>
+#include <GL/glew.h>
+#include "constants.hpp"
+
+//---------------------//
+// Stream Buffer Class //
+//---------------------//
+// Ring of STREAM_SEGMENTS vertex buffer segments for geometry that
+// changes every frame. Each frame writes into its own segment, which a
+// fence guards until the GPU has drawn from it, so writing never waits
+// on draws still in flight and the driver never has to copy or sync
+// behind our back. With ARB_buffer_storage the buffer is mapped once,
+// persistently and coherently, and writes go straight into it. Without
+// it, they are staged and uploaded with one glBufferSubData per commit.
+//
+// Usage per frame: beginFrame(), then any number of allocate() and
+// commit() pairs, drawing from buffer() at the offset commit() returns,
+// then endFrame() once the draws are issued.
+class StreamBuffer
+{
+public:
+    StreamBuffer();
+    bool create(GLsizeiptr isegmentSize);
+    void destroy();
+    void beginFrame();
+    void endFrame();
+    GLfloat* allocate(int floats);
+    GLintptr commit();
+    GLuint buffer() const;
+    unsigned version() const;
+    bool persistent() const;
+private:
+    bool allocateStorage();
+    void waitSegment(int s);
+
+    GLuint vbo;
+    unsigned bufferVersion;     // bumped whenever vbo is replaced
+    GLsizeiptr segmentSize;     // bytes
+    int segment;                // segment the current frame writes to
+    GLsizeiptr used;            // bytes of it committed so far
+    GLsizeiptr pending;         // bytes allocated but not yet committed
+    GLsync fences[STREAM_SEGMENTS];
+    GLubyte* mapped;            // the whole buffer, when persistent
+    std::vector<GLfloat> staging;   // pending writes otherwise
+};
+
+#endif
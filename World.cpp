@@ -0,0 +1,723 @@
+// World.cpp
+#include "World.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include "CollisionDetector.hpp"
+#include "GravityKernel.hpp"
+
+// hitPlanet value for a bullet that flew off the board:
+#define BULLET_LOST -2
+
+// --PURPOSE--
+// Set up an empty world.
+// --PARAMETERS--
+// workers:         Worker threads for the simulation, -1 for one per core.
+// bulletCapacity:  Bullets that fit before the bullet pool has to grow.
+// planetCapacity:  Planets that fit before the planet pool has to grow.
+World::World(int workers, int bulletCapacity, int planetCapacity)
+    : planetSlots(planetCapacity), bullets(bulletCapacity), jobs(workers)
+{
+    this->planets.resize(this->planetSlots.capacity());
+    this->width = 150.0f;
+    this->height = 150.0f;
+    this->shotRad = BULLET_RAD;
+    this->shotMass = BULLET_MASS;
+    this->bulletGravity = false;
+    this->useGravityField = false;
+    this->exactCollision = false;
+    this->craters = true;
+    this->stepDt = SIM_DT;
+    this->bodyCount = 0;
+    this->treeActive = false;
+    this->fieldActive = false;
+    this->clear();
+}
+
+// Remove every planet and bullet and reset the clock. The pools keep
+// their capacity:
+void World::clear()
+{
+    const int* active = this->planetSlots.active();
+    for (int i = 0; i < this->planetSlots.count(); ++i)
+    {
+        planet& pl = this->planets[active[i]];
+        pl.clean();
+        pl.maxRad = 0.0f;
+        pl.mass = 0.0f;
+        ++pl.meshVersion;
+    }
+    this->planetSlots.clear();
+    this->bullets.clear();
+    this->impacts.clear();
+    this->simTime = 0.0;
+    this->ticks = 0;
+}
+
+// Make room for at least this many bullets and planets up front:
+void World::reserve(int nbullets, int nplanets)
+{
+    this->bullets.reserve(nbullets);
+    this->planetSlots.reserve(nplanets);
+    this->planets.resize(this->planetSlots.capacity());
+}
+
+// Add a bullet to the scene:
+handle World::addBullet(glm::vec2 ipos, glm::vec2 ivel)
+{
+    return this->bullets.add(ipos, ivel, this->shotRad, this->shotMass,
+                             float(this->simTime));
+}
+
+// Add a planet with a random size, spin and color to the scene:
+handle World::addPlanet(glm::vec2 ipos)
+{
+    float orient = (rand()%360)*(PI/180.0f);
+    float rotSpeed = 
+        float((((rand()%MAX_ROTATION)+1)-MAX_ROTATION/2))*(60.0f/1000.0f);
+    float maxRad = (rand()%10)+10.0f;
+    glm::vec3 color = glm::vec3(((rand()%100)+1)/100.0f,
+                                ((rand()%100)+1)/100.0f,
+                                ((rand()%100)+1)/100.0f);
+    return this->addPlanet(ipos, maxRad, rotSpeed, orient, color);
+}
+
+// --PURPOSE--
+// Add a planet to the scene in a free slot, growing the planet pool if
+// none are left.
+// --RETURNS--
+// A handle to the planet, with slot -1 if the pool may not grow.
+handle World::addPlanet(glm::vec2 ipos, float imaxRad, float irotSpeed,
+                        float iorient, glm::vec3 icolor)
+{
+    if (!this->planetSlots.hasFree() && this->planetSlots.grow())
+        this->planets.resize(this->planetSlots.capacity());
+
+    handle h = this->planetSlots.allocate();
+    if (-1 == h.slot) return h;
+
+    planet& pl = this->planets[h.slot];
+    pl.orient = iorient;
+    pl.rotSpeed = irotSpeed;
+    pl.pos = ipos;
+    pl.changePlanetGraphic(imaxRad);
+    pl.color = icolor;
+    return h;
+}
+
+// --PURPOSE--
+// Take a planet out of the scene and return its slot to the pool.
+// --RETURNS--
+// false if the planet was already gone.
+bool World::removePlanet(handle h)
+{
+    if (!this->planetSlots.release(h)) return false;
+
+    planet& pl = this->planets[h.slot];
+    pl.clean();
+    pl.maxRad = 0.0f;
+    pl.mass = 0.0f;
+    ++pl.meshVersion;
+    return true;
+}
+
+void World::updatePlanets(float dt)
+{
+    const int* active = planetSlots.active();
+    for (int i = 0; i < planetSlots.count(); ++i)
+    {
+        planet& pl = planets[active[i]];
+        // Spin the planet a bit:
+        pl.orient += pl.rotSpeed*dt;
+        if (pl.orient >= TAU) pl.orient -= TAU;
+        else if (pl.orient <= 0.0f) pl.orient += TAU;
+        pl.updateWorldGeometry();
+    }
+}
+
+// --PURPOSE--
+// Gather the bodies that pull on bullets and rebuild everything built
+// from them: the planet grid, the tree, and the field when it's on.
+// Planets come first, followed by the live bullets when withBullets.
+void World::gatherBodies(bool withBullets)
+{
+    int bulletCount = bullets.count();
+    int planetCount = planetSlots.count();
+    const int* livePlanets = planetSlots.active();
+
+    // Scratch space only ever grows, so steady play doesn't allocate:
+    int maxBodies = planetCount + (withBullets ? bulletCount : 0);
+    if (int(bodyX.size()) < maxBodies)
+    {
+        bodyX.resize(maxBodies);
+        bodyY.resize(maxBodies);
+        bodyGM.resize(maxBodies);
+    }
+    if (int(planetRad.size()) < planetCount) planetRad.resize(planetCount);
+
+    bodyCount = 0;
+    for (int i = 0; i < planetCount; ++i)
+    {
+        const planet& pl = planets[livePlanets[i]];
+        bodyX[bodyCount] = pl.pos[0];
+        bodyY[bodyCount] = pl.pos[1];
+        bodyGM[bodyCount] = float(GRAVITY_SCALE*GRAVITATIONAL*pl.mass);
+        planetRad[bodyCount] = pl.maxRad;
+        ++bodyCount;
+    }
+    for (int i = 0; withBullets && i < bulletCount; ++i)
+    {
+        int b = bullets.active()[i];
+        bodyX[bodyCount] = bullets.posX[b];
+        bodyY[bodyCount] = bullets.posY[b];
+        bodyGM[bodyCount] =
+            float(GRAVITY_SCALE*GRAVITATIONAL*bullets.mass[b]);
+        ++bodyCount;
+    }
+
+    // Planets are indexed in the grid by their place in the active list:
+    planetGrid.build(bodyX.data(), bodyY.data(), planetRad.data(),
+                     planetCount);
+
+    treeActive = (bodyCount >= BH_MIN_BODIES);
+    if (treeActive)
+        gravityTree.build(bodyX.data(), bodyY.data(), bodyGM.data(),
+                          bodyCount);
+
+    // The field only holds planets, so it can't stand in for the sum when
+    // bullets pull on each other too:
+    fieldActive = useGravityField && !withBullets;
+    if (fieldActive) syncGravityField();
+}
+
+// --PURPOSE--
+// Pull on a set of bullets from the bodies of the last gatherBodies().
+// The direct sum is exact, the tree takes over for big scenes. With the
+// field on, only the bullets it can't answer for are summed.
+// --PARAMETERS--
+// bx, by:      Bullet positions, indexed by slot.
+// index:       The slots to work on.
+// count:       Number of entries in index.
+// ax, ay:      Output, one acceleration per entry of index.
+// scratch:     Where this call's room in exactSlot and friends starts.
+//              Calls running at the same time need separate ranges.
+void World::pull(const float* bx, const float* by, const int* index,
+                 int count, float* ax, float* ay, int scratch)
+{
+    int sumCount = count;
+    float* sumX = ax;
+    float* sumY = ay;
+    int* slots = &exactSlot[scratch];
+    int* entries = &exactEntry[scratch];
+    if (fieldActive)
+    {
+        sumCount = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            int b = index[i];
+            if (gravityField.sample(bx[b], by[b], &ax[i], &ay[i])) continue;
+            slots[sumCount] = b;
+            entries[sumCount] = i;
+            ++sumCount;
+        }
+        index = slots;
+        sumX = &exactAX[scratch];
+        sumY = &exactAY[scratch];
+    }
+    if (treeActive)
+        gravityTree.accumulate(bx, by, index, sumCount, sumX, sumY);
+    else if (0 < sumCount)
+        GravityKernel::accumulate(bx, by, index, sumCount,
+                                  bodyX.data(), bodyY.data(),
+                                  bodyGM.data(), bodyCount, sumX, sumY);
+    for (int k = 0; fieldActive && k < sumCount; ++k)
+    {
+        ax[entries[k]] = sumX[k];
+        ay[entries[k]] = sumY[k];
+    }
+}
+
+// Bullets past these lines are lost:
+bool World::offBoard(const glm::vec2& pos) const
+{
+    return pos[0] < -BULLET_BOUNDS*width
+        || pos[0] > (1.0f+BULLET_BOUNDS)*width
+        || pos[1] < -BULLET_BOUNDS*height
+        || pos[1] > (1.0f+BULLET_BOUNDS)*height;
+}
+
+// --PURPOSE--
+// List the planets near anywhere a bullet went this step, using the grid
+// of the last gatherBodies().
+// --PARAMETERS--
+// start, end:  Where the bullet started and ended the step.
+// rad:         The radius of the bullet.
+// candidates:  Output, GRID_MAX_CANDIDATES positions in the live planet
+//              list, in order.
+// --RETURNS--
+// How many were listed, or -1 if there were too many to list, in which
+// case every live planet is near.
+int World::queryPlanets(const glm::vec2& start, const glm::vec2& end,
+                        float rad, int* candidates) const
+{
+    int found = planetGrid.query(std::min(start[0], end[0]) - rad,
+                                 std::min(start[1], end[1]) - rad,
+                                 std::max(start[0], end[0]) + rad,
+                                 std::max(start[1], end[1]) + rad,
+                                 candidates, GRID_MAX_CANDIDATES);
+    return (found > GRID_MAX_CANDIDATES) ? -1 : found;
+}
+
+// Where a bullet that touched a planet at toi along its step comes to
+// rest, just inside the surface:
+glm::vec2 World::landAt(const glm::vec2& start, const glm::vec2& end,
+                        float toi)
+{
+    glm::vec2 step = end-start;
+    float len = glm::length(step);
+    float t = (len > TOL) ? toi + SWEEP_SKIN/len : 1.0f;
+    if (t > 1.0f) t = 1.0f;
+    return start + t*step;
+}
+
+// --PURPOSE--
+// Sweep one bullet's step against the planets near it. The earliest
+// contact wins, wherever along the step it happens, and the planet
+// earliest in the live list wins a tie. updateBullets does the same for
+// every bullet at once in sweepBullets.
+// --PARAMETERS--
+// start:   Where the bullet started the step.
+// end:     Where it ended. Moved to just inside the surface on a hit.
+// rad:     The radius of the bullet.
+// ahead:   How far past now the step is, in seconds. Planets are turned
+//          to where they will be by then.
+// --RETURNS--
+// The slot of the planet that was hit, or -1.
+int World::sweepPlanets(const glm::vec2& start, glm::vec2& end,
+                        float rad, float ahead) const
+{
+    const int* livePlanets = planetSlots.active();
+    int candidates[GRID_MAX_CANDIDATES];
+    int found = queryPlanets(start, end, rad, candidates);
+    bool overflow = (0 > found);
+    if (overflow) found = planetSlots.count();
+
+    int hit = -1;
+    float firstToi = 2.0f;
+    for (int k = 0; k < found; ++k)
+    {   
+        int p = livePlanets[overflow ? k : candidates[k]];
+        float toi;
+        float spin = ahead*planets[p].rotSpeed;
+        bool touched = exactCollision
+            ? CollisionDetector::sweepCollision(planets[p], rad, start, end,
+                                                &toi, spin)
+            : CollisionDetector::sweepDistanceField(planets[p], rad, start,
+                                                    end, &toi, spin);
+        if (touched && toi < firstToi)
+        {
+            firstToi = toi;
+            hit = p;
+            // Nothing can come before touching at the start:
+            if (0.0f == toi) break;
+        }
+    }
+
+    if (-1 != hit) end = landAt(start, end, firstToi);
+    return hit;
+}
+
+// --PURPOSE--
+// Sweep every live bullet's step against the planets near it, with the
+// outcome sweepPlanets would give each one. The bullet-planet pairs from
+// the grid are grouped by planet, and each planet rules out the bullets
+// whose swept capsule misses it in one batched pass of
+// CollisionDetector::sweepCollisions, so only the bullets left get the
+// full sweep. The planets are spread over the workers.
+// --PARAMETERS--
+// bulletCount: Number of live bullets. Their entries of hitPlanet must
+//              be -1 or BULLET_LOST, hitToi 2, and nearPlanets filled.
+//              Bullets that hit get hitPlanet and are moved to where they
+//              landed.
+void World::sweepBullets(int bulletCount)
+{
+    using namespace glm;
+
+    // Count the pairs of each live planet, then lay them out in planet
+    // order. Within a planet they stay in active list order:
+    int liveCount = planetSlots.count();
+    pairStart.assign(liveCount+1, 0);
+    maskStart.assign(liveCount+1, 0);
+    for (int i = 0; i < bulletCount; ++i)
+    {
+        const int* near = &nearPlanets[i*GRID_MAX_CANDIDATES];
+        if (0 > nearCount[i])
+            for (int a = 0; a < liveCount; ++a) ++pairStart[a];
+        for (int k = 0; k < nearCount[i]; ++k) ++pairStart[near[k]];
+    }
+    int pairCount = 0;
+    for (int a = 0; a <= liveCount; ++a)
+    {
+        int n = pairStart[a];
+        pairStart[a] = pairCount;
+        pairCount += n;
+        if (a < liveCount) maskStart[a+1] = maskStart[a] + (n+31)/32;
+    }
+    if (int(pairSlot.size()) < pairCount)
+    {
+        pairSlot.resize(pairCount);
+        pairEntry.resize(pairCount);
+        pairToi.resize(pairCount);
+    }
+    if (int(pairMask.size()) < maskStart[liveCount])
+        pairMask.resize(maskStart[liveCount]);
+    for (int i = 0; i < bulletCount; ++i)
+    {
+        const int* near = &nearPlanets[i*GRID_MAX_CANDIDATES];
+        int found = (0 > nearCount[i]) ? liveCount : nearCount[i];
+        for (int k = 0; k < found; ++k)
+        {
+            int pair = pairStart[(0 > nearCount[i]) ? k : near[k]]++;
+            pairSlot[pair] = bullets.active()[i];
+            pairEntry[pair] = i;
+        }
+    }
+    // Filling moved each start to the next planet's, put them back:
+    for (int a = liveCount; a > 0; --a) pairStart[a] = pairStart[a-1];
+    pairStart[0] = 0;
+
+    // Each job only reads bullet and planet state and only writes its own
+    // planet's pairs:
+    const int* livePlanets = planetSlots.active();
+    jobs.parallelFor(liveCount, 1, [&](int begin, int end)
+    {
+        for (int a = begin; a < end; ++a)
+        {
+            int first = pairStart[a];
+            int count = pairStart[a+1]-first;
+            if (0 == count) continue;
+            const planet& pl = planets[livePlanets[a]];
+            unsigned* mask = &pairMask[maskStart[a]];
+            CollisionDetector::sweepCollisions(pl, startX.data(),
+                                               startY.data(),
+                                               bullets.posX.data(),
+                                               bullets.posY.data(),
+                                               bullets.rad.data(),
+                                               &pairSlot[first], count,
+                                               mask);
+            for (int k = 0; k < count; ++k)
+            {
+                pairToi[first+k] = 2.0f;
+                if (0 == (mask[k/32] & (1u << (k%32)))) continue;
+                int b = pairSlot[first+k];
+                vec2 start = vec2(startX[b], startY[b]);
+                vec2 end = vec2(bullets.posX[b], bullets.posY[b]);
+                float toi;
+                bool touched = exactCollision
+                    ? CollisionDetector::sweepCollision(pl, bullets.rad[b],
+                                                        start, end, &toi)
+                    : CollisionDetector::sweepDistanceField(pl,
+                                                            bullets.rad[b],
+                                                            start, end,
+                                                            &toi);
+                if (touched) pairToi[first+k] = toi;
+            }
+        }
+    });
+
+    // Earliest contact of each bullet, in planet order like sweepPlanets:
+    for (int a = 0; a < liveCount; ++a)
+        for (int pair = pairStart[a]; pair < pairStart[a+1]; ++pair)
+        {
+            int i = pairEntry[pair];
+            if (pairToi[pair] < hitToi[i])
+            {
+                hitToi[i] = pairToi[pair];
+                hitPlanet[i] = livePlanets[a];
+            }
+        }
+    for (int i = 0; i < bulletCount; ++i)
+    {
+        if (0 > hitPlanet[i]) continue;
+        int b = bullets.active()[i];
+        vec2 end = landAt(vec2(startX[b], startY[b]),
+                          vec2(bullets.posX[b], bullets.posY[b]), hitToi[i]);
+        bullets.posX[b] = end[0];
+        bullets.posY[b] = end[1];
+    }
+}
+
+// The first half of a bullet's step, along its velocity. Gravity is
+// summed where this lands, then finishStep does the rest:
+glm::vec2 World::halfDrift(const glm::vec2& pos, const glm::vec2& vel,
+                           float dt)
+{
+    return pos + (0.5f*dt)*vel;
+}
+
+// --PURPOSE--
+// The rest of a bullet's step from the midpoint: the kick from the
+// gravity there, capped at MAX_BULLET_SPEED, and the second half drift.
+// Shared by updateBullets and previewShots, so a previewed shot flies
+// exactly like a fired one. What the step ran into is up to the caller.
+// --PARAMETERS--
+// pos:     The midpoint, moved to where the step ends.
+// vel:     The velocity, kicked.
+// acc:     Acceleration per unit mass at the midpoint, from pull().
+// mass:    The bullet's.
+// dt:      Length of the step.
+// --RETURNS--
+// False if the bullet ended up off the board, and is lost.
+bool World::finishStep(glm::vec2& pos, glm::vec2& vel, const glm::vec2& acc,
+                       float mass, float dt) const
+{
+    using namespace glm;
+
+    // Kick, up to the speed limit:
+    vel += dt*(mass*acc);
+    if (length(vel) > MAX_BULLET_SPEED)
+        vel = MAX_BULLET_SPEED*normalize(vel);
+
+    // Second drift:
+    pos += (0.5f*dt)*vel;
+    return !offBoard(pos);
+}
+
+// --PURPOSE--
+// Advance every live bullet by one step of length dt. Uses the
+// drift-kick-drift form of leapfrog: a half step along the velocity,
+// a full velocity update from gravity at the midpoint, then the second
+// half step. It is symplectic and needs one gravity sum per step.
+void World::updateBullets(float dt)
+{
+    // namespace resolution
+    using namespace glm;
+
+    float halfDt = 0.5f*dt;
+    int bulletCount = bullets.count();
+    if (int(accX.size()) < bulletCount)
+    {
+        accX.resize(bulletCount);
+        accY.resize(bulletCount);
+        hitPlanet.resize(bulletCount);
+        hitToi.resize(bulletCount);
+        nearPlanets.resize(bulletCount*GRID_MAX_CANDIDATES);
+        nearCount.resize(bulletCount);
+        exactSlot.resize(bulletCount);
+        exactEntry.resize(bulletCount);
+        exactAX.resize(bulletCount);
+        exactAY.resize(bulletCount);
+    }
+    if (startX.size() < bullets.posX.size())
+    {
+        startX.resize(bullets.posX.size());
+        startY.resize(bullets.posX.size());
+    }
+
+    // First drift. Only the slots of each chunk's own bullets are written:
+    jobs.parallelFor(bulletCount, BULLET_CHUNK,
+                     [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            int b = bullets.active()[i];
+            vec2 mid = halfDrift(vec2(bullets.posX[b], bullets.posY[b]),
+                                 vec2(bullets.velX[b], bullets.velY[b]), dt);
+            bullets.posX[b] = mid[0];
+            bullets.posY[b] = mid[1];
+        }
+    });
+
+    // Everything built here is shared read-only by every chunk below:
+    gatherBodies(bulletGravity);
+
+    // Each chunk only reads planet state and only writes the slots of its
+    // own bullets, so chunks can run on any core in any order.
+    jobs.parallelFor(bulletCount, BULLET_CHUNK,
+                     [&](int begin, int end)
+    {
+        // Gravitational pull on this chunk at the midpoint:
+        pull(bullets.posX.data(), bullets.posY.data(),
+             bullets.active()+begin, end-begin,
+             &accX[begin], &accY[begin], begin);
+
+        for (int i = begin; i < end; ++i)
+        {
+            int b = bullets.active()[i];
+
+            // Where the bullet started the step, for its swept bounds:
+            vec2 bStart = vec2(bullets.posX[b], bullets.posY[b])
+                        - halfDt*vec2(bullets.velX[b], bullets.velY[b]);
+
+            vec2 bPos = vec2(bullets.posX[b], bullets.posY[b]);
+            vec2 vel = vec2(bullets.velX[b], bullets.velY[b]);
+            bool onBoard = finishStep(bPos, vel, vec2(accX[i], accY[i]),
+                                      bullets.mass[b], dt);
+            bullets.velX[b] = vel[0];
+            bullets.velY[b] = vel[1];
+            bullets.posX[b] = bPos[0];
+            bullets.posY[b] = bPos[1];
+            startX[b] = bStart[0];
+            startY[b] = bStart[1];
+
+            // Lost bullets are near nothing:
+            hitPlanet[i] = onBoard ? -1 : BULLET_LOST;
+            hitToi[i] = 2.0f;
+            nearCount[i] = onBoard
+                ? queryPlanets(bStart, bPos, bullets.rad[b],
+                               &nearPlanets[i*GRID_MAX_CANDIDATES])
+                : 0;
+        }
+    });
+
+    // What each bullet ran into on the way:
+    sweepBullets(bulletCount);
+
+    // Merge the collisions in active list order, so the outcome doesn't
+    // depend on which thread ran what. Walk backwards so that killing a
+    // bullet never moves one that hasn't been looked at yet.
+    for (int i = bulletCount-1; i >= 0; --i)
+    {
+        if (-1 == hitPlanet[i]) continue;
+        int b = bullets.active()[i];
+        if (BULLET_LOST == hitPlanet[i])
+        {
+            bullets.kill(b);
+            continue;
+        }
+        impact hit;
+        hit.planet = hitPlanet[i];
+        hit.pos = glm::vec2(bullets.posX[b], bullets.posY[b]);
+        hit.rad = bullets.rad[b];
+        hit.normal = CollisionDetector::surfaceNormal(planets[hit.planet],
+                                                      hit.pos);
+        CollisionDetector::recordContact(planets[hit.planet], hit.rad,
+                                         hit.pos, hit.normal);
+        if (craters) planets[hit.planet].crater(hit.pos, CRATER_RAD);
+        this->impacts.push_back(hit);
+        bullets.kill(b);
+    }
+}
+
+// --PURPOSE--
+// Predict where a batch of shots would go without firing them, e.g. to
+// show aiming lines. Each shot is stepped like a live bullet in
+// updateBullets, with the planets turning as they would, but alone: the
+// live bullets don't pull on it. A shot stops early when it lands or
+// leaves the board. Shots are spread over the workers. Must not run
+// while a step is in progress.
+// --PARAMETERS--
+// pos, vel:    Launch position and velocity of each shot.
+// count:       Number of shots.
+// steps:       Most steps of stepDt to look ahead.
+// stride:      Record a point every stride steps.
+// paths:       Output, one trajectory per shot. Passing the same vector
+//              each frame reuses its memory.
+void World::previewShots(const glm::vec2* pos, const glm::vec2* vel,
+                         int count, int steps, int stride,
+                         std::vector<trajectory>& paths)
+{
+    using namespace glm;
+
+    if (0 >= stride) stride = 1;
+    paths.resize(count);
+    if (int(exactSlot.size()) < count)
+    {
+        exactSlot.resize(count);
+        exactEntry.resize(count);
+        exactAX.resize(count);
+        exactAY.resize(count);
+    }
+    gatherBodies(false);
+
+    float dt = stepDt;
+    jobs.parallelFor(count, PREVIEW_CHUNK, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            trajectory& path = paths[i];
+            path.points.clear();
+            path.points.push_back(pos[i]);
+            path.planet = -1;
+            path.lost = false;
+
+            vec2 p = pos[i];
+            vec2 v = vel[i];
+            for (int s = 1; s <= steps; ++s)
+            {
+                // The same step as updateBullets:
+                vec2 next = halfDrift(p, v, dt);
+                float ax, ay;
+                int slot = 0;
+                pull(&next[0], &next[1], &slot, 1, &ax, &ay, i);
+                path.lost = !finishStep(next, v, vec2(ax, ay), shotMass,
+                                        dt);
+                if (!path.lost)
+                    path.planet = sweepPlanets(p, next, shotRad, s*dt);
+                p = next;
+
+                bool done = path.lost || -1 != path.planet;
+                if (done || 0 == s%stride || s == steps)
+                    path.points.push_back(p);
+                if (done) break;
+            }
+        }
+    });
+}
+
+// --PURPOSE--
+// Bring gravityField up to date with the planets. Only planets that
+// appeared, disappeared or changed since the last call are touched, and
+// the field starts over if the play area changed size.
+void World::syncGravityField()
+{
+    if (!gravityField.covers(0.0f, 0.0f, width, height, FIELD_CELL))
+    {
+        gravityField.resize(0.0f, 0.0f, width, height, FIELD_CELL);
+        fieldBodies.clear();
+    }
+    if (fieldBodies.size() < planets.size())
+    {
+        fieldBody none = {false, 0.0f, 0.0f, 0.0f, 0.0f};
+        fieldBodies.resize(planets.size(), none);
+    }
+
+    for (size_t s = 0; s < planets.size(); ++s)
+    {
+        fieldBody& fb = fieldBodies[s];
+        const planet& pl = planets[s];
+        bool alive = planetSlots.isAlive(int(s));
+        float gm = float(GRAVITY_SCALE*GRAVITATIONAL*pl.mass);
+        bool same = fb.x == pl.pos[0] && fb.y == pl.pos[1]
+                 && fb.gm == gm && fb.rad == pl.maxRad;
+
+        if (fb.added && (!alive || !same))
+        {
+            gravityField.removeBody(fb.x, fb.y, fb.gm, fb.rad);
+            fb.added = false;
+        }
+        if (alive && !fb.added)
+        {
+            fb.x = pl.pos[0];
+            fb.y = pl.pos[1];
+            fb.gm = gm;
+            fb.rad = pl.maxRad;
+            gravityField.addBody(fb.x, fb.y, fb.gm, fb.rad);
+            fb.added = true;
+        }
+    }
+}
+
+// Number of threads the simulation runs on:
+int World::threadCount() const
+{
+    return this->jobs.threadCount();
+}
+
+// One fixed step of the whole simulation:
+void World::step()
+{
+    this->updatePlanets(this->stepDt);
+    this->updateBullets(this->stepDt);
+    this->simTime += this->stepDt;
+    ++this->ticks;
+}
@@ -0,0 +1,159 @@
+// World.hpp
+#ifndef WORLD_HPP_
+#define WORLD_HPP_
+#include <vector>
+#include <glm/glm.hpp>
+#include "constants.hpp"
+#include "satellite.hpp"
+#include "HandlePool.hpp"
+#include "BulletPool.hpp"
+#include "BarnesHut.hpp"
+#include "GravityField.hpp"
+#include "SpatialGrid.hpp"
+#include "JobPool.hpp"
+
+//-------------//
+// World Class //
+//-------------//
+// All game state and the fixed-step simulation. Makes no GL or GLUT
+// calls, so it runs the same with or without a window.
+class World
+{
+public:
+    // A bullet that landed during a step:
+    struct impact
+    {
+        int planet;
+        glm::vec2 pos;
+        float rad;
+        glm::vec2 normal;   // outward surface normal where it landed
+    };
+
+    // A shot predicted by previewShots:
+    struct trajectory
+    {
+        std::vector<glm::vec2> points;  // launch position, then sampled
+        int planet;                     // slot of the planet hit, or -1
+        bool lost;                      // flew off the board
+    };
+
+    World(int workers = -1, int bulletCapacity = BULLET_CAPACITY,
+          int planetCapacity = PLANET_CAPACITY);
+    void clear();
+    void reserve(int nbullets, int nplanets);
+    handle addBullet(glm::vec2 ipos, glm::vec2 ivel);
+    handle addPlanet(glm::vec2 ipos);
+    handle addPlanet(glm::vec2 ipos, float imaxRad, float irotSpeed,
+                     float iorient, glm::vec3 icolor);
+    bool removePlanet(handle h);
+    void updatePlanets(float dt);
+    void updateBullets(float dt);
+    void step();
+    void previewShots(const glm::vec2* pos, const glm::vec2* vel,
+                      int count, int steps, int stride,
+                      std::vector<trajectory>& paths);
+    int threadCount() const;
+
+    // Game objects. Planets are indexed by slot, dead slots have no data
+    // and a maxRad of 0:
+    std::vector<planet> planets;
+    HandlePool planetSlots;
+    BulletPool bullets;
+
+    // What addBullet gives new bullets, and previewShots its shots:
+    float shotRad;
+    float shotMass;
+
+    // Play area, in game units:
+    float width;
+    float height;
+
+    // Simulation clock, advanced in fixed steps of stepDt. Collisions are
+    // swept over each step, so steps longer than SIM_DT don't tunnel:
+    float stepDt;
+    double simTime;
+    long ticks;
+
+    // Broad phase between bullets and planets, rebuilt every step:
+    SpatialGrid planetGrid;
+    // Narrow phase against the exact outlines instead of the planets'
+    // distance fields, to check one against the other:
+    bool exactCollision;
+    bool craters;           // landed bullets dig into the planets
+
+    // Gravity settings:
+    BarnesHut gravityTree;
+    GravityField gravityField;
+    bool bulletGravity;     // bullets also attract each other
+    bool useGravityField;   // sample planet gravity from gravityField
+
+    // Landed bullets since the list was last cleared by the caller:
+    std::vector<impact> impacts;
+private:
+    // What a planet slot last contributed to gravityField:
+    struct fieldBody
+    {
+        bool added;
+        float x, y, gm, rad;
+    };
+
+    void syncGravityField();
+    void gatherBodies(bool withBullets);
+    void pull(const float* bx, const float* by, const int* index,
+              int count, float* ax, float* ay, int scratch);
+    bool offBoard(const glm::vec2& pos) const;
+    static glm::vec2 halfDrift(const glm::vec2& pos, const glm::vec2& vel,
+                               float dt);
+    bool finishStep(glm::vec2& pos, glm::vec2& vel, const glm::vec2& acc,
+                    float mass, float dt) const;
+    int queryPlanets(const glm::vec2& start, const glm::vec2& end,
+                     float rad, int* candidates) const;
+    static glm::vec2 landAt(const glm::vec2& start, const glm::vec2& end,
+                            float toi);
+    int sweepPlanets(const glm::vec2& start, glm::vec2& end,
+                     float rad, float ahead) const;
+    void sweepBullets(int bulletCount);
+
+    JobPool jobs;
+    std::vector<fieldBody> fieldBodies;
+
+    // Bodies that pull on bullets, from the last gatherBodies():
+    int bodyCount;
+    bool treeActive;    // gravityTree holds them
+    bool fieldActive;   // gravityField stands in for the planets
+    std::vector<float> bodyX;
+    std::vector<float> bodyY;
+    std::vector<float> bodyGM;
+    std::vector<float> planetRad;   // bounds of the planets among the bodies
+
+    // Per-bullet results of a step, ordered like the active list:
+    std::vector<float> accX;
+    std::vector<float> accY;
+    std::vector<int> hitPlanet;
+    std::vector<float> hitToi;
+
+    // Where each bullet started the step, by slot:
+    std::vector<float> startX;
+    std::vector<float> startY;
+
+    // Planets near each bullet's step, GRID_MAX_CANDIDATES per entry of
+    // the active list, and how many, -1 for all of them:
+    std::vector<int> nearPlanets;
+    std::vector<int> nearCount;
+
+    // Bullet-planet pairs, grouped by planet, see sweepBullets():
+    std::vector<int> pairStart;     // first pair of each live planet, then the end
+    std::vector<int> maskStart;     // first word of each live planet's pairMask
+    std::vector<int> pairSlot;
+    std::vector<int> pairEntry;     // position in the active list
+    std::vector<float> pairToi;
+    std::vector<unsigned> pairMask;
+
+    // Bullets that gravityField couldn't answer for, see pull():
+    std::vector<int> exactSlot;
+    std::vector<int> exactEntry;    // position in the active list
+    std::vector<float> exactAX;
+    std::vector<float> exactAY;
+};
+
+#endif
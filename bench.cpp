@@ -0,0 +1,542 @@
+// bench.cpp
+// Microbenchmarks for the simulation library. Every case uses a fixed
+// seed, so two runs on the same machine do the same work, and results
+// are written as JSON so they can be diffed between commits:
+//   $ ./bench before.json
+//   $ ./bench after.json
+//   $ diff before.json after.json
+// Without a file name the JSON goes to stdout.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include <string>
+#include <vector>
+#include "World.hpp"
+#include "CollisionDetector.hpp"
+#include "GravityKernel.hpp"
+#include "BarnesHut.hpp"
+#include "GravityField.hpp"
+#include "DistanceField.hpp"
+
+#define BENCH_SEED 12345
+#define BENCH_REPEATS 5             // the median of these is reported
+#define BENCH_MIN_SECONDS 0.05      // minimum length of one repeat
+#define BENCH_BULLETS 1000          // bullets in flight for worldStep
+
+// Results only have to be observable, not meaningful:
+static volatile float sink = 0.0f;
+static bool firstResult = true;
+static FILE *out = stdout;
+
+// Every heap allocation in the process is counted, so each record can
+// report how many allocations one operation makes. The replacements stay
+// out of line: inlined, GCC pairs the malloc in one with the free in
+// another and warns of a mismatch.
+static std::atomic<long> allocations(0);
+
+__attribute__((noinline))
+void* operator new(size_t size)
+{
+    ++allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline))
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+__attribute__((noinline))
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline))
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline))
+void operator delete(void* p, size_t size) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline))
+void operator delete[](void* p, size_t size) noexcept
+{
+    free(p);
+}
+
+// Uniform random float in [lo, hi]:
+static float randRange(float lo, float hi)
+{
+    return lo + (hi-lo)*(float(rand())/RAND_MAX);
+}
+
+// --PURPOSE--
+// Time fn, which does opsPerCall operations per call, and print one
+// JSON record.
+// --PARAMETERS--
+// name:    Benchmark name.
+// params:  JSON object body with the parameters of this case.
+// fn:      The work to time.
+template <typename F>
+static void run(const char *name, const std::string& params,
+                long opsPerCall, F fn)
+{
+    using namespace std::chrono;
+
+    // Find a call count that takes long enough to time:
+    long calls = 1;
+    for (;;)
+    {
+        steady_clock::time_point t0 = steady_clock::now();
+        for (long c = 0; c < calls; ++c) fn();
+        double s = duration<double>(steady_clock::now()-t0).count();
+        if (s >= BENCH_MIN_SECONDS || calls >= (1L << 30)) break;
+        calls *= 2;
+    }
+
+    std::vector<double> nsPerOp;
+    nsPerOp.reserve(BENCH_REPEATS);
+    long allocs0 = allocations;
+    for (int r = 0; r < BENCH_REPEATS; ++r)
+    {
+        steady_clock::time_point t0 = steady_clock::now();
+        for (long c = 0; c < calls; ++c) fn();
+        double s = duration<double>(steady_clock::now()-t0).count();
+        nsPerOp.push_back(1E9*s/double(calls*opsPerCall));
+    }
+    double allocsPerOp = double(allocations-allocs0)
+                       / double(BENCH_REPEATS*calls*opsPerCall);
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+
+    fprintf(out,
+            "%s    {\"name\": \"%s\", \"params\": {%s}, "
+            "\"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f, "
+            "\"allocs_per_op\": %.3g}",
+            firstResult ? "" : ",\n",
+            name, params.c_str(),
+            nsPerOp[BENCH_REPEATS/2], nsPerOp[0], allocsPerOp);
+    firstResult = false;
+}
+
+// Params object bodies:
+static std::string param(const char *key, int value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\"%s\": %d", key, value);
+    return buf;
+}
+
+static std::string param(const char *key, const char *value)
+{
+    return std::string("\"")+key+"\": \""+value+"\"";
+}
+
+//-----------------------//
+// Collision Benchmarks  //
+//-----------------------//
+struct CollisionBench
+{
+    // Bullets spread around the planet's surface, where the narrow phase
+    // actually runs:
+    static void makeBullets(const planet& pl, int count,
+                            std::vector<glm::vec2>& pos)
+    {
+        pos.clear();
+        for (int b = 0; b < count; ++b)
+        {
+            float angle = randRange(0.0f, TAU);
+            float dist = randRange(0.5f, 1.2f)*pl.maxRad;
+            pos.push_back(pl.pos+dist*glm::vec2(cos(angle), sin(angle)));
+        }
+    }
+
+    static void runAll()
+    {
+        srand(BENCH_SEED);
+        planet pl(15.0f, glm::vec2(0.0f));
+        pl.orient = 0.7f;
+        pl.updateWorldGeometry();
+        std::vector<glm::vec2> pos;
+        makeBullets(pl, 1024, pos);
+        const float rad = 0.25f;
+        std::string params = param("bullets", int(pos.size()));
+
+        run("checkCollision", params, long(pos.size()), [&]()
+        {
+            int hits = 0;
+            for (size_t b = 0; b < pos.size(); ++b)
+                hits += CollisionDetector::checkCollision(pl, rad, pos[b]);
+            sink = sink + float(hits);
+        });
+
+        run("getTriangleList", params, long(pos.size()), [&]()
+        {
+            int total = 0;
+            for (size_t b = 0; b < pos.size(); ++b)
+            {
+                float list[MAX_TRI_LIST];
+                total += CollisionDetector::getTriangleList(pl, rad, pos[b],
+                                                            list);
+            }
+            sink = sink + float(total);
+        });
+
+        // Each bullet moves a full step at top speed toward the center:
+        run("sweepCollision", params, long(pos.size()), [&]()
+        {
+            int hits = 0;
+            for (size_t b = 0; b < pos.size(); ++b)
+            {
+                glm::vec2 dir = glm::normalize(pl.pos-pos[b]);
+                glm::vec2 end = pos[b] + (MAX_BULLET_SPEED*SIM_DT)*dir;
+                float toi;
+                hits += CollisionDetector::sweepCollision(pl, rad, pos[b],
+                                                          end, &toi);
+            }
+            sink = sink + float(hits);
+        });
+
+        // The same queries answered from the distance field:
+        run("checkDistanceField", params, long(pos.size()), [&]()
+        {
+            int hits = 0;
+            for (size_t b = 0; b < pos.size(); ++b)
+                hits += CollisionDetector::checkDistanceField(pl, rad, pos[b]);
+            sink = sink + float(hits);
+        });
+
+        run("sweepDistanceField", params, long(pos.size()), [&]()
+        {
+            int hits = 0;
+            for (size_t b = 0; b < pos.size(); ++b)
+            {
+                glm::vec2 dir = glm::normalize(pl.pos-pos[b]);
+                glm::vec2 end = pos[b] + (MAX_BULLET_SPEED*SIM_DT)*dir;
+                float toi;
+                hits += CollisionDetector::sweepDistanceField(pl, rad, pos[b],
+                                                              end, &toi);
+            }
+            sink = sink + float(hits);
+        });
+
+        // One fan triangle per bullet, taken from the planet outline:
+        std::vector<float> tris;
+        const float* data = pl.getPlanetData();
+        for (size_t b = 0; b < pos.size(); ++b)
+        {
+            int v = int(b%NUM_PLANET_VERTS);
+            float tri[6] = {
+                pl.pos[0], pl.pos[1],
+                pl.pos[0]+data[2*v+2], pl.pos[1]+data[2*v+3],
+                pl.pos[0]+data[2*v+4], pl.pos[1]+data[2*v+5]
+            };
+            tris.insert(tris.end(), tri, tri+6);
+        }
+        run("polyCircleCheck", params, long(pos.size()), [&]()
+        {
+            int hits = 0;
+            for (size_t b = 0; b < pos.size(); ++b)
+                hits += CollisionDetector::polyCircleCheck(&tris[6*b], 3,
+                                                           rad, pos[b]);
+            sink = sink + float(hits);
+        });
+
+        // The whole batch at once, each bullet stepping toward the
+        // center, on every path the CPU has:
+        std::vector<float> bx, by, ex, ey, br;
+        std::vector<int> index;
+        for (size_t b = 0; b < pos.size(); ++b)
+        {
+            glm::vec2 end = pos[b] + (MAX_BULLET_SPEED*SIM_DT)
+                                   * glm::normalize(pl.pos-pos[b]);
+            bx.push_back(pos[b][0]);
+            by.push_back(pos[b][1]);
+            ex.push_back(end[0]);
+            ey.push_back(end[1]);
+            br.push_back(rad);
+            index.push_back(int(b));
+        }
+        std::vector<unsigned> mask((pos.size()+31)/32);
+        const GravityPath paths[] = {GRAVITY_SCALAR, GRAVITY_SSE4,
+                                     GRAVITY_AVX2};
+        for (int k = 0; k < 3; ++k)
+        {
+            if (GravityKernel::setPath(paths[k]) != paths[k]) continue;
+            run("sweepCollisions",
+                params+", "+param("path", GravityKernel::pathName(paths[k])),
+                long(pos.size()), [&]()
+            {
+                sink = sink + float(CollisionDetector::sweepCollisions(
+                    pl, bx.data(), by.data(), ex.data(), ey.data(),
+                    br.data(), index.data(), int(index.size()),
+                    mask.data()));
+            });
+        }
+        GravityKernel::setPath(GravityKernel::bestPath());
+
+        // The same triangles tested against the cached normals:
+        run("fanCircleCheck", params, long(pos.size()), [&]()
+        {
+            int hits = 0;
+            for (size_t b = 0; b < pos.size(); ++b)
+                hits += CollisionDetector::fanCircleCheck(pl,
+                            int(b%NUM_PLANET_VERTS), rad, pos[b]);
+            sink = sink + float(hits);
+        });
+    }
+};
+
+//---------------------//
+// Gravity Benchmarks  //
+//---------------------//
+static void gravityBenchmarks()
+{
+    const int bulletCounts[] = {100, 1000, 10000};
+    const int planetCounts[] = {5, 50, 250};
+    const GravityPath paths[] = {GRAVITY_SCALAR, GRAVITY_SSE4, GRAVITY_AVX2};
+
+    for (int bc = 0; bc < 3; ++bc)
+    for (int pc = 0; pc < 3; ++pc)
+    {
+        srand(BENCH_SEED);
+        int bullets = bulletCounts[bc];
+        int planets = planetCounts[pc];
+        std::vector<float> bx(bullets), by(bullets), ax(bullets), ay(bullets);
+        std::vector<int> index(bullets);
+        std::vector<float> px(planets), py(planets), gm(planets);
+        for (int b = 0; b < bullets; ++b)
+        {
+            bx[b] = randRange(0.0f, 150.0f);
+            by[b] = randRange(0.0f, 150.0f);
+            index[b] = b;
+        }
+        for (int p = 0; p < planets; ++p)
+        {
+            px[p] = randRange(0.0f, 150.0f);
+            py[p] = randRange(0.0f, 150.0f);
+            gm[p] = float(GRAVITY_SCALE*GRAVITATIONAL*PLANET_MASS*15.0f);
+        }
+        std::string params = param("bullets", bullets)+", "
+                           + param("planets", planets);
+
+        // The direct sum on every path the CPU has:
+        for (int k = 0; k < 3; ++k)
+        {
+            if (GravityKernel::setPath(paths[k]) != paths[k]) continue;
+            run("gravityDirect",
+                params+", "+param("path", GravityKernel::pathName(paths[k])),
+                long(bullets)*planets, [&]()
+            {
+                GravityKernel::accumulate(&bx[0], &by[0], &index[0], bullets,
+                                          &px[0], &py[0], &gm[0], planets,
+                                          &ax[0], &ay[0]);
+                sink = sink + ax[0];
+            });
+        }
+        GravityKernel::setPath(GravityKernel::bestPath());
+
+        // Barnes-Hut, including building the tree:
+        BarnesHut tree;
+        run("gravityBarnesHut", params, long(bullets)*planets, [&]()
+        {
+            tree.build(&px[0], &py[0], &gm[0], planets);
+            tree.accumulate(&bx[0], &by[0], &index[0], bullets,
+                            &ax[0], &ay[0]);
+            sink = sink + ax[0];
+        });
+
+        // Cached field, built once like a static scene. Bullets near a
+        // planet take the exact sum, as in World:
+        GravityField field;
+        field.resize(0.0f, 0.0f, 150.0f, 150.0f, FIELD_CELL);
+        for (int p = 0; p < planets; ++p)
+            field.addBody(px[p], py[p], gm[p], 15.0f);
+        // The exact sums come out in the order of the exact list, and are
+        // scattered back to their bullets like World::pull does:
+        std::vector<int> exact(bullets);
+        std::vector<float> exactX(bullets), exactY(bullets);
+        run("gravityField", params, long(bullets)*planets, [&]()
+        {
+            int exactCount = 0;
+            for (int b = 0; b < bullets; ++b)
+                if (!field.sample(bx[b], by[b], &ax[b], &ay[b]))
+                    exact[exactCount++] = b;
+            GravityKernel::accumulate(&bx[0], &by[0], &exact[0], exactCount,
+                                      &px[0], &py[0], &gm[0], planets,
+                                      &exactX[0], &exactY[0]);
+            for (int k = 0; k < exactCount; ++k)
+            {
+                ax[exact[k]] = exactX[k];
+                ay[exact[k]] = exactY[k];
+            }
+            sink = sink + ax[0];
+        });
+    }
+}
+
+//------------------------------//
+// Planet Generation Benchmarks //
+//------------------------------//
+static void planetBenchmarks()
+{
+    srand(BENCH_SEED);
+    run("createPlanetData", param("verts", NUM_PLANET_VERTS), 1, [&]()
+    {
+        float* data = createPlanetData(15.0f);
+        sink = sink + data[2];
+        delete [] data;
+    });
+
+    float* outline = createPlanetData(15.0f);
+    DistanceField field;
+    run("buildDistanceField", param("resolution", SDF_RESOLUTION), 1, [&]()
+    {
+        field.build(outline);
+        sink = sink + field.distance(0.0f, 0.0f);
+    });
+    delete [] outline;
+
+    // Craters at spots on the surface, each call starting from the same
+    // untouched planet. The copy back is included in the time:
+    planet pristine(15.0f, glm::vec2(0.0f));
+    planet pl(pristine);
+    std::vector<glm::vec2> spots;
+    for (int c = 0; c < 16; ++c)
+    {
+        glm::vec2 from = 20.0f*glm::vec2(cos(c*0.39f), sin(c*0.39f));
+        float toi = 0.0f;
+        if (CollisionDetector::sweepCollision(pristine, BULLET_RAD, from,
+                                              glm::vec2(0.0f), &toi))
+            spots.push_back((1.0f-toi)*from);
+    }
+    run("crater", param("craters", int(spots.size())), long(spots.size()),
+        [&]()
+    {
+        pl = pristine;
+        for (size_t c = 0; c < spots.size(); ++c)
+            sink = sink + float(pl.crater(spots[c], CRATER_RAD));
+    });
+
+    const int mapSizes[] = {NUM_PLANET_VERTS, 256, 4096};
+    for (int m = 0; m < 3; ++m)
+    {
+        std::vector<float> map(mapSizes[m]);
+        run("genRandomFractalMap", param("points", mapSizes[m]), 1, [&]()
+        {
+            std::fill(map.begin(), map.end(), 0.0f);
+            genRandomFractalMap(1.0f, 0, mapSizes[m]-1, &map[0]);
+            sink = sink + map[mapSizes[m]/2];
+        });
+    }
+}
+
+//--------------------------//
+// Whole Simulation Step    //
+//--------------------------//
+static void worldBenchmarks()
+{
+    // Bullets respawned inside a planet land on the same spot every step,
+    // so the plain records leave craters out and stay comparable, and
+    // the crater records show what they add:
+    const int planetCounts[] = {5, 50, 250};
+    for (int craters = 0; craters < 2; ++craters)
+    for (int pc = 0; pc < 3; ++pc)
+    {
+        srand(BENCH_SEED);
+        World *world = new World(0);
+        world->craters = (0 != craters);
+        for (int p = 0; p < planetCounts[pc]; ++p)
+            world->addPlanet(glm::vec2(randRange(0.0f, world->width),
+                                       randRange(0.0f, world->height)));
+
+        // Refill the pool before each step so every step has the same
+        // number of bullets in flight:
+        std::vector<glm::vec2> start(BENCH_BULLETS);
+        for (int b = 0; b < BENCH_BULLETS; ++b)
+            start[b] = glm::vec2(randRange(0.0f, world->width),
+                                 randRange(0.0f, world->height));
+        std::string params = param("bullets", BENCH_BULLETS)+", "
+                           + param("planets", planetCounts[pc]);
+        if (craters) params += ", "+param("craters", 1);
+        run("worldStep", params, 1, [&]()
+        {
+            world->bullets.clear();
+            for (int b = 0; b < BENCH_BULLETS; ++b)
+                world->addBullet(start[b], glm::vec2(0.0f));
+            world->step();
+            world->impacts.clear();
+        });
+        delete world;
+    }
+}
+
+//--------------------------//
+// Aiming Preview           //
+//--------------------------//
+static void previewBenchmarks()
+{
+    const int planetCounts[] = {5, 50};
+    for (int pc = 0; pc < 2; ++pc)
+    {
+        srand(BENCH_SEED);
+        World *world = new World(0);
+        for (int p = 0; p < planetCounts[pc]; ++p)
+            world->addPlanet(glm::vec2(randRange(0.0f, world->width),
+                                       randRange(0.0f, world->height)));
+
+        // A ring of shots from the middle of the board, as the UI does:
+        std::vector<glm::vec2> pos(PREVIEW_SHOTS), vel(PREVIEW_SHOTS);
+        for (int i = 0; i < PREVIEW_SHOTS; ++i)
+        {
+            float angle = float(TAU)*i/PREVIEW_SHOTS;
+            pos[i] = 0.5f*glm::vec2(world->width, world->height);
+            vel[i] = (0.5f*MAX_BULLET_SPEED)
+                   * glm::vec2(cos(angle), sin(angle));
+        }
+        std::vector<World::trajectory> paths;
+        run("previewShots",
+            param("shots", PREVIEW_SHOTS)+", "
+            +param("steps", PREVIEW_STEPS)+", "
+            +param("planets", planetCounts[pc]),
+            PREVIEW_SHOTS, [&]()
+        {
+            world->previewShots(&pos[0], &vel[0], PREVIEW_SHOTS,
+                                PREVIEW_STEPS, PREVIEW_STRIDE, paths);
+            sink = sink + paths[0].points.back()[0];
+        });
+        delete world;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && NULL == (out = fopen(argv[1], "w")))
+    {
+        fprintf(stderr, "%s: Can't open for writing\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "{\n  \"gravity_path\": \"%s\",\n  \"benchmarks\": [\n",
+            GravityKernel::pathName(GravityKernel::bestPath()));
+    CollisionBench::runAll();
+    gravityBenchmarks();
+    planetBenchmarks();
+    worldBenchmarks();
+    previewBenchmarks();
+    fprintf(out, "\n  ]\n}\n");
+    if (stdout != out) fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,324 @@
+// check.cpp
+// Checks the fast collision paths against the exact ones, and that the
+// narrow phase never allocates. Every case uses a fixed seed, so a
+// failure can be run again as is:
+//   $ make check
+// Prints one line per check and exits with failure if any disagree.
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <glm/glm.hpp>
+#include "CollisionDetector.hpp"
+#include "GravityKernel.hpp"
+#include "satellite.hpp"
+
+#define CHECK_SEED 4242
+#define CHECK_PLANETS 200       // random planets per check
+#define CHECK_SWEEPS 5000       // sweeps per planet
+#define CHECK_TOI_TOL 1E-3f     // largest difference in where a hit lands
+
+// Every heap allocation in the process is counted, see checkAllocations.
+// Out of line for the same reason as in bench.cpp:
+static std::atomic<long> allocations(0);
+
+__attribute__((noinline))
+void* operator new(size_t size)
+{
+    ++allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline))
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+__attribute__((noinline))
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline))
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline))
+void operator delete(void* p, size_t size) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline))
+void operator delete[](void* p, size_t size) noexcept
+{
+    free(p);
+}
+
+// Uniform random float in [lo, hi]:
+static float randRange(float lo, float hi)
+{
+    return lo + (hi-lo)*(float(rand())/RAND_MAX);
+}
+
+// --PURPOSE--
+// sweepDistanceField must hit exactly where sweepCollision does. The
+// planets are cratered, for concave corners, and the moves start around
+// the surface, from well short of a step to several steps long.
+// --RETURNS--
+// The number of sweeps that disagree.
+static int checkSweeps()
+{
+    srand(CHECK_SEED);
+    long sweeps = 0;
+    long hits = 0;
+    int missed = 0;     // exact hits the field missed
+    int extra = 0;      // field hits the exact sweep didn't have
+    int moved = 0;      // both hit, in different places
+    float worst = 0.0f;
+    for (int p = 0; p < CHECK_PLANETS; ++p)
+    {
+        planet pl(randRange(5.0f, 20.0f), glm::vec2(0.0f));
+        pl.orient = randRange(0.0f, TAU);
+        pl.updateWorldGeometry();
+        for (int c = 0; c < 8; ++c)
+        {
+            float angle = randRange(0.0f, TAU);
+            glm::vec2 from = 2.0f*pl.maxRad*glm::vec2(cos(angle), sin(angle));
+            float toi;
+            if (CollisionDetector::sweepCollision(pl, BULLET_RAD, from,
+                                                  glm::vec2(0.0f), &toi))
+                pl.crater((1.0f-toi)*from, randRange(0.5f, 2.0f)*CRATER_RAD);
+        }
+
+        for (int s = 0; s < CHECK_SWEEPS; ++s)
+        {
+            float angle = randRange(0.0f, TAU);
+            float dist = randRange(0.3f, 1.5f)*pl.maxRad;
+            glm::vec2 p0 = dist*glm::vec2(cos(angle), sin(angle));
+            float heading = randRange(0.0f, TAU);
+            float len = randRange(0.0f, 4.0f)*MAX_BULLET_SPEED*SIM_DT;
+            glm::vec2 p1 = p0+len*glm::vec2(cos(heading), sin(heading));
+            float spin = (0 == s%2) ? 0.0f : randRange(-0.1f, 0.1f);
+
+            float exactToi = 0.0f;
+            float fieldToi = 0.0f;
+            bool exact = CollisionDetector::sweepCollision(
+                pl, BULLET_RAD, p0, p1, &exactToi, spin);
+            bool field = CollisionDetector::sweepDistanceField(
+                pl, BULLET_RAD, p0, p1, &fieldToi, spin);
+            ++sweeps;
+            hits += exact ? 1 : 0;
+            if (exact && !field) ++missed;
+            else if (field && !exact) ++extra;
+            else if (exact)
+            {
+                float off = fabsf(exactToi-fieldToi)*len;
+                if (off > worst) worst = off;
+                if (off > CHECK_TOI_TOL) ++moved;
+            }
+        }
+    }
+
+    int failures = missed+extra+moved;
+    fprintf(stdout, "%s sweepDistanceField: %ld sweeps, %ld hits, "
+            "%d missed, %d extra, %d moved (worst %g units)\n",
+            (0 == failures) ? "ok  " : "FAIL", sweeps, hits, missed, extra,
+            moved, worst);
+    return failures;
+}
+
+// --PURPOSE--
+// sweepCollisions rules bullets out before the full sweep, so it must
+// never rule out one that sweepCollision or sweepDistanceField finds
+// touching, and every path the CPU has must give the same mask. The
+// moves are made like checkSweeps', without spin.
+// --RETURNS--
+// The number of bullets ruled out that touch, plus masks that differ.
+static int checkBatchSweeps()
+{
+    srand(CHECK_SEED);
+    const int batch = 256;
+    std::vector<float> x0(batch), y0(batch), x1(batch), y1(batch);
+    std::vector<float> rad(batch, BULLET_RAD);
+    std::vector<int> index(batch);
+    std::vector<unsigned> mask((batch+31)/32), best((batch+31)/32);
+    const GravityPath paths[] = {GRAVITY_SCALAR, GRAVITY_SSE4, GRAVITY_AVX2};
+    long sweeps = 0;
+    long kept = 0;
+    long hits = 0;
+    int missed = 0;     // hits outside the mask
+    int differ = 0;     // masks that differ between paths
+    for (int p = 0; p < CHECK_PLANETS; ++p)
+    {
+        planet pl(randRange(5.0f, 20.0f), glm::vec2(randRange(-50.0f, 50.0f),
+                                                    randRange(-50.0f, 50.0f)));
+        pl.orient = randRange(0.0f, TAU);
+        pl.updateWorldGeometry();
+        for (int c = 0; c < 4; ++c)
+            pl.crater(pl.pos + pl.maxRad*glm::vec2(cos(c*1.7f), sin(c*1.7f)),
+                      randRange(0.5f, 2.0f)*CRATER_RAD);
+
+        for (int s = 0; s < CHECK_SWEEPS/batch; ++s)
+        {
+            for (int b = 0; b < batch; ++b)
+            {
+                float angle = randRange(0.0f, TAU);
+                float dist = randRange(0.3f, 1.5f)*pl.maxRad;
+                glm::vec2 from = pl.pos + dist*glm::vec2(cos(angle),
+                                                         sin(angle));
+                float heading = randRange(0.0f, TAU);
+                float len = randRange(0.0f, 4.0f)*MAX_BULLET_SPEED*SIM_DT;
+                glm::vec2 to = from+len*glm::vec2(cos(heading), sin(heading));
+                // Shuffled slots, so index is followed:
+                int slot = (b*97)%batch;
+                x0[slot] = from[0];
+                y0[slot] = from[1];
+                x1[slot] = to[0];
+                y1[slot] = to[1];
+                index[b] = slot;
+            }
+
+            GravityKernel::setPath(GRAVITY_SCALAR);
+            kept += CollisionDetector::sweepCollisions(pl, x0.data(),
+                        y0.data(), x1.data(), y1.data(), rad.data(),
+                        index.data(), batch, best.data());
+            for (int k = 1; k < 3; ++k)
+            {
+                if (GravityKernel::setPath(paths[k]) != paths[k]) continue;
+                CollisionDetector::sweepCollisions(pl, x0.data(), y0.data(),
+                    x1.data(), y1.data(), rad.data(), index.data(), batch,
+                    mask.data());
+                for (size_t w = 0; w < mask.size(); ++w)
+                    differ += (mask[w] != best[w]) ? 1 : 0;
+            }
+
+            for (int b = 0; b < batch; ++b)
+            {
+                int slot = index[b];
+                glm::vec2 from(x0[slot], y0[slot]);
+                glm::vec2 to(x1[slot], y1[slot]);
+                float toi;
+                bool exact = CollisionDetector::sweepCollision(pl, BULLET_RAD,
+                                                               from, to, &toi);
+                bool field = CollisionDetector::sweepDistanceField(
+                    pl, BULLET_RAD, from, to, &toi);
+                bool inMask = 0 != (best[b/32] & (1u << (b%32)));
+                ++sweeps;
+                hits += exact ? 1 : 0;
+                if ((exact || field) && !inMask) ++missed;
+            }
+        }
+    }
+    GravityKernel::setPath(GravityKernel::bestPath());
+
+    int failures = missed+differ;
+    fprintf(stdout, "%s sweepCollisions: %ld sweeps, %ld hits, %ld kept, "
+            "%d missed, %d masks differ\n",
+            (0 == failures) ? "ok  " : "FAIL", sweeps, hits, kept, missed,
+            differ);
+    return failures;
+}
+
+// Print one check's allocation count:
+static int reportAllocations(const char* name, long count)
+{
+    fprintf(stdout, "%s %s: %ld allocations\n",
+            (0 == count) ? "ok  " : "FAIL", name, count);
+    return (0 == count) ? 0 : 1;
+}
+
+//---------------------//
+// Collision Checks    //
+//---------------------//
+// A friend of CollisionDetector, to reach the narrow phase:
+struct CollisionCheck
+{
+    // --PURPOSE--
+    // The narrow phase runs for every bullet near a planet, every step,
+    // and must never touch the heap. Each query runs for bullets all
+    // around a planet's surface while the allocation counter is watched.
+    // --RETURNS--
+    // The number of queries that allocated.
+    static int checkAllocations()
+    {
+        srand(CHECK_SEED);
+        planet pl(15.0f, glm::vec2(0.0f));
+        pl.orient = 0.7f;
+        pl.updateWorldGeometry();
+        std::vector<glm::vec2> pos;
+        for (int b = 0; b < 1024; ++b)
+        {
+            float angle = randRange(0.0f, TAU);
+            float dist = randRange(0.5f, 1.2f)*pl.maxRad;
+            pos.push_back(dist*glm::vec2(cos(angle), sin(angle)));
+        }
+        const float* data = pl.getPlanetData();
+        int failures = 0;
+        int hits = 0;
+
+        long before = allocations;
+        for (size_t b = 0; b < pos.size(); ++b)
+            hits += CollisionDetector::checkCollision(pl, BULLET_RAD,
+                                                      pos[b]);
+        failures += reportAllocations("checkCollision",
+                                      allocations-before);
+
+        before = allocations;
+        for (size_t b = 0; b < pos.size(); ++b)
+        {
+            float list[MAX_TRI_LIST];
+            hits += CollisionDetector::getTriangleList(pl, BULLET_RAD,
+                                                       pos[b], list);
+        }
+        failures += reportAllocations("getTriangleList",
+                                      allocations-before);
+
+        before = allocations;
+        for (size_t b = 0; b < pos.size(); ++b)
+        {
+            int v = int(b%NUM_PLANET_VERTS);
+            float tri[6] = {
+                0.0f, 0.0f,
+                data[2*v+2], data[2*v+3],
+                data[2*v+4], data[2*v+5]
+            };
+            hits += CollisionDetector::polyCircleCheck(tri, 3, BULLET_RAD,
+                                                       pos[b]);
+        }
+        failures += reportAllocations("polyCircleCheck",
+                                      allocations-before);
+
+        before = allocations;
+        for (size_t b = 0; b < pos.size(); ++b)
+        {
+            glm::vec2 end = pos[b] - (MAX_BULLET_SPEED*SIM_DT)
+                                   * glm::normalize(pos[b]);
+            float toi;
+            hits += CollisionDetector::sweepCollision(pl, BULLET_RAD,
+                                                      pos[b], end, &toi);
+        }
+        failures += reportAllocations("sweepCollision",
+                                      allocations-before);
+
+        // Keeps the queries from being optimized out:
+        if (0 > hits) fprintf(stdout, "%d\n", hits);
+        return failures;
+    }
+};
+
+int main()
+{
+    int failures = checkSweeps();
+    failures += checkBatchSweeps();
+    failures += CollisionCheck::checkAllocations();
+    return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -11,12 +11,66 @@
 #define NUM_DRAW_LAYERS 100
 #define NUM_CIRCLE_VERTS 10    // Does not include the center! At least 3.
 #define NUM_PLANET_VERTS 18    // Does not include the center! At least 3.
+#define BULLET_INSTANCE_FLOATS 6   // x, y, radius, r, g, b per drawn bullet
+#define PLANET_ATLAS_VERTS (NUM_PLANET_VERTS+1) // center and rim per planet in the atlas
+#define PLANET_DATA_FLOATS 8       // x, y, cos, sin, r, g, b, a per drawn planet
+#define STREAM_BUFFER_FLOATS 65536 // floats per frame the stream buffer starts with
+#define STREAM_SEGMENTS 3          // frames the stream buffer keeps in flight
+#define STREAM_WAIT_NS 1000000     // fence wait between checks, in nanoseconds
 
 // Game objects:
-#define MAX_PLANET 5
-#define MAX_BULLET 1000
+#define PLANET_CAPACITY 16     // starting pool sizes, pools grow as needed
+#define BULLET_CAPACITY 256
+#define BULLET_BOUNDS 1.0f     // bullets this many play areas off the board are lost
 #define PLANET_MASS 1E7
 #define MAX_BULLET_SPEED 25.0f
+#define BULLET_RAD 0.25f
+#define BULLET_MASS 10.0f
 #define MAX_ROTATION 25 
 
+// Simulation:
+#define SIM_HZ 60                   // fixed simulation steps per second
+#define SIM_DT (1.0f/SIM_HZ)
+#define MAX_SIM_STEPS 8             // most steps run to catch up per frame
+
+// Frame pacing:
+#define FRAME_HZ 60                 // frames per second aimed for, and the budget
+#define FRAME_TIMER_MARGIN_MS 2     // GLUT timers wake this early, then sleep exactly
+#define FRAME_REPORT_SECONDS 1.0f   // how often frame times are printed
+
+// Aiming preview:
+#define PREVIEW_SHOTS 64        // shots previewed in a ring around the mouse
+#define PREVIEW_STEPS 180       // steps each previewed shot looks ahead
+#define PREVIEW_STRIDE 3        // steps between drawn points
+
+// Debug drawing:
+#define DEBUG_DRAW_CAPACITY 8192    // commands kept between flushes, more are dropped
+
+// Gravity:
+#define GRAVITY_SCALE 1E4   // game tuning on top of GRAVITATIONAL
+#define BH_THETA 0.5f       // Barnes-Hut opening angle
+#define BH_MAX_DEPTH 24     // deeper quadtree leaves hold several bodies
+#define BH_MIN_BODIES 64    // below this many bodies the direct sum is used
+#define FIELD_CELL 1.0f         // node spacing of the cached gravity field
+#define FIELD_EXACT_SCALE 1.5f  // within this many planet radii, sum exactly
+
+// Collision:
+#define MAX_POLY_VERTS 32       // largest polygon the SAT checks take
+#define OUTLINE_EDGE_FLOATS 6   // floats per edge in sweepCollisions
+#define SDF_RESOLUTION 48       // distance field nodes along each side
+#define SDF_MARGIN 0.15f        // field reaches this fraction past the outline
+#define SDF_TRUNCATE 3.0f       // distances are clamped to this many cells
+#define SDF_MAX_MARCH 24        // sphere tracing steps before the exact sweep
+#define CRATER_RAD 1.5f         // radius of the crater a landed bullet leaves
+#define CRATER_MIN_SCALE 0.2f   // craters never dig below this fraction of maxRad
+#define MAX_TRI_LIST (2*NUM_PLANET_VERTS+4) // floats in a getTriangleList fan
+#define SWEEP_SKIN 0.01f        // how far a landed bullet ends up inside the surface
+#define SWEEP_FILTER_SLACK 1E-3f // batched sweeps grow bullets this much, for rounding
+#define GRID_MAX_CELLS 4096     // upper bound on the planet grid size
+#define GRID_MAX_CANDIDATES 32  // past this many planets near a bullet, test them all
+
+// Threading:
+#define BULLET_CHUNK 64     // bullets per job when updating in parallel
+#define PREVIEW_CHUNK 4     // previewed shots per job
+
 #endif
@@ -1,6 +1,12 @@
 // draw.c
 // Authors: Ed Markowski, Joey Parker
 #include "draw.hpp"
+#include <GL/glxew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 //----------------------//
 // File-Scope Variables //
@@ -10,65 +16,177 @@ static GLfloat drawLayer = 0.0f;
 static GLuint shaderID = 0;
 static GLuint circleVBO = GL_INVALID_VALUE;
 static GLuint squareVBO = GL_INVALID_VALUE;
+static GLuint circleVAO = GL_INVALID_VALUE;
+static GLuint squareVAO = GL_INVALID_VALUE;
+static GLuint bulletVAO = GL_INVALID_VALUE;
+static std::vector<DebugDraw::command> debugCommands;
 static GLuint a_position;
-static GLuint u_modelview;
-static GLuint u_viewport;
+static GLuint a_offset;
+static GLuint a_tint;
+static GLuint u_object;
 static GLuint u_projection;
 static GLuint u_color;
+static GLuint u_fromAtlas;
+static GLuint u_atlasVerts;
+static GLuint u_planets;
+
+// Every planet outline lives in one shared atlas buffer, PLANET_ATLAS_VERTS
+// vertices per planet slot, drawn through one index list that serves as
+// a fan for the fill and a loop for the outline. Per-planet placement
+// and color go in a texture buffer the vertex shader reads by slot.
+static GLuint atlasVBO = GL_INVALID_VALUE;
+static GLuint atlasIBO = GL_INVALID_VALUE;
+static GLuint atlasVAO = GL_INVALID_VALUE;
+static int atlasSlots = 0;                      // planet slots it holds
+static std::vector<unsigned> planetVersions;    // meshVersion each slot holds
+static std::vector<unsigned> planetEdits;       // editVersion each slot holds
+static GLuint planetDataVBO = GL_INVALID_VALUE;
+static GLuint planetDataTBO = GL_INVALID_VALUE;
+static std::vector<GLfloat> planetData;         // PLANET_DATA_FLOATS per slot
+static std::vector<GLsizei> planetFillCounts;   // multi-draw lists, per planet
+static std::vector<GLsizei> planetLineCounts;
+static std::vector<const GLvoid*> planetFillFirst;
+static std::vector<const GLvoid*> planetLineFirst;
+static std::vector<GLint> planetBaseVertex;
+
+// Everything made up on the fly, e.g. lines, debug triangles and the
+// bullet instances, is written once a frame into one ring buffer:
+static StreamBuffer streamRing;
+static GLuint streamVAO = GL_INVALID_VALUE;     // positions from the ring
+
+// What was last handed to GL, so that draws in a row with the same mesh,
+// color or transform don't repeat the calls. Only this file binds vertex
+// arrays and buffers, and only while the shader is in use.
+static struct
+{
+    GLuint vao;
+    GLuint arrayBuffer;
+    unsigned ringVersion;   // streamRing.version() when last bound
+    unsigned streamVersion; // the same, when streamVAO last pointed at it
+    bool colorSet;
+    glm::vec4 color;
+    bool objectSet;
+    GLfloat object[2*4];
+} drawState = {0, 0, 0, 0, false, glm::vec4(0.0f), false, {0.0f}};
 
 //---------------//
-// Draw Commands //
+// State Tracker //
 //---------------//
-void drawPlanet(GLuint planetVBO, glm::vec2 pos, GLfloat rot)
+static void bindVertexArray(GLuint vao)
+{
+    if (drawState.vao == vao) return;
+    glBindVertexArray(vao);
+    drawState.vao = vao;
+}
+
+static void bindArrayBuffer(GLuint vbo)
 {
-    if (GL_FALSE == glIsBuffer(planetVBO))
+    if (drawState.arrayBuffer == vbo) return;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    drawState.arrayBuffer = vbo;
+}
+
+// Bind the stream ring's buffer. A replaced ring may have been given
+// the old buffer's name, so the tracker is no help then:
+static void bindRingBuffer()
+{
+    if (drawState.ringVersion == streamRing.version())
     {
-        // Display warning.
+        bindArrayBuffer(streamRing.buffer());
         return;
     }
+    glBindBuffer(GL_ARRAY_BUFFER, streamRing.buffer());
+    drawState.arrayBuffer = streamRing.buffer();
+    drawState.ringVersion = streamRing.version();
+}
 
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(pos, drawLayer));
-    if (0.0f != rot) mMat = glm::rotate(mMat, rot, vec3(0.0f, 0.0f, 1.0f));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, value_ptr(mMat));
-    glBindBuffer(GL_ARRAY_BUFFER, planetVBO);
-    glEnableVertexAttribArray(a_position);
+// Bind streamVAO, pointed at the start of the current ring buffer:
+static void bindStreamArray()
+{
+    bindVertexArray(streamVAO);
+    if (drawState.streamVersion == streamRing.version()) return;
+    bindRingBuffer();
     glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, NUM_PLANET_VERTS+2);
-    glDisableVertexAttribArray(a_position);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    drawState.streamVersion = streamRing.version();
 }
 
-void drawWirePlanet(GLuint planetVBO, glm::vec2 pos, GLfloat rot)
+// --PURPOSE--
+// Place the next object, on the current draw layer. The vertex shader
+// builds the transform from these 8 floats, so nothing is multiplied
+// out here and the upload is one vec4 pair.
+// --PARAMETERS--
+// pos:         Where the mesh origin goes, in game coordinates.
+// rot:         Cosine and sine of the rotation, counterclockwise.
+// size:        Scale of the mesh along x and y, before rotating.
+static void setObject(glm::vec2 pos, glm::vec2 rot, glm::vec2 size)
 {
-    if (GL_FALSE == glIsBuffer(planetVBO))
-    {
-        // Display warning.
-        return;
-    }
+    const GLfloat object[2*4] = {
+        pos[0],  pos[1],  rot[0],    rot[1],
+        size[0], size[1], drawLayer, 0.0f
+    };
+    if (drawState.objectSet
+        && 0 == memcmp(drawState.object, object, sizeof(object))) return;
+    glUniform4fv(u_object, 2, object);
+    memcpy(drawState.object, object, sizeof(object));
+    drawState.objectSet = true;
+}
 
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(pos, drawLayer));
-    if (0.0f != rot) mMat = rotate(mMat, rot, vec3(0.0f, 0.0f, 1.0f));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, value_ptr(mMat));
-    glBindBuffer(GL_ARRAY_BUFFER, planetVBO);
+// For geometry already in game coordinates:
+static void setLayerObject()
+{
+    setObject(glm::vec2(0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f));
+}
+
+// --PURPOSE--
+// Make a vertex array that reads 2D positions from a mesh buffer.
+// Everything else stays at the defaults set by setShaderHandles.
+static GLuint createMeshVAO(GLuint vbo)
+{
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    bindVertexArray(vao);
+    bindArrayBuffer(vbo);
     glEnableVertexAttribArray(a_position);
     glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glDrawArrays(GL_LINE_LOOP, 1, NUM_PLANET_VERTS);
-    glDisableVertexAttribArray(a_position);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vao;
+}
+
+// --PURPOSE--
+// Finish a write to the stream ring made with streamRing.allocate() and
+// get ready to draw it from streamVAO.
+// --RETURNS--
+// The index of the first vertex written.
+static GLint streamCommit()
+{
+    GLintptr offset = streamRing.commit();
+    bindStreamArray();
+    return GLint(offset/(2*sizeof(GLfloat)));
 }
 
+//---------------//
+// Draw Commands //
+//---------------//
 void drawLine(glm::vec2 p0, glm::vec2 p1)
 {
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(0.0f, 0.0f, drawLayer));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, value_ptr(mMat));
-    const GLfloat linePoints[] = {p0[0], p0[1], p1[0], p1[1]};
-    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, linePoints);
-    glEnableVertexAttribArray(a_position);
-    glDrawArrays(GL_LINES, 0, 2);
-    glDisableVertexAttribArray(a_position);
+    GLfloat* dst = streamRing.allocate(4);
+    dst[0] = p0[0];
+    dst[1] = p0[1];
+    dst[2] = p1[0];
+    dst[3] = p1[1];
+    GLint first = streamCommit();
+    setLayerObject();
+    glDrawArrays(GL_LINES, first, 2);
+}
+
+// Connected lines through a list of points, in one draw:
+void drawLineStrip(const glm::vec2* points, int count)
+{
+    if (count < 2) return;
+    GLfloat* dst = streamRing.allocate(2*count);
+    memcpy(dst, &points[0][0], sizeof(GLfloat)*2*count);
+    GLint first = streamCommit();
+    setLayerObject();
+    glDrawArrays(GL_LINE_STRIP, first, count);
 }
 
 void drawSquare(GLfloat width, glm::vec2 pos)
@@ -83,70 +201,338 @@ void drawWireSquare(GLfloat width, glm::vec2 pos)
 
 void drawRectangle(GLfloat width, GLfloat height, glm::vec2 pos)
 {
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(pos, drawLayer));
-    mMat = scale(mMat, vec3(width, height, 0.0f));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, value_ptr(mMat));
-    glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
-    glEnableVertexAttribArray(a_position);
-    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    setObject(pos, glm::vec2(1.0f, 0.0f), glm::vec2(width, height));
+    bindVertexArray(squareVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glDisableVertexAttribArray(a_position);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void drawWireRectangle(GLfloat width, GLfloat height, glm::vec2 pos)
 {
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(pos, drawLayer));
-    mMat = scale(mMat, vec3(width, height, 0.0f));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, glm::value_ptr(mMat));
-    glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
-    glEnableVertexAttribArray(a_position);
-    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    setObject(pos, glm::vec2(1.0f, 0.0f), glm::vec2(width, height));
+    bindVertexArray(squareVAO);
     glDrawArrays(GL_LINE_LOOP, 4, 4);
-    glDisableVertexAttribArray(a_position);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void drawCircle(GLfloat rad, glm::vec2 pos)
 {
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(pos, drawLayer));
-    mMat = scale(mMat, vec3(rad, rad, 0.0f));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, glm::value_ptr(mMat));
-    glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
-    glEnableVertexAttribArray(a_position);
-    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    setObject(pos, glm::vec2(1.0f, 0.0f), glm::vec2(rad));
+    bindVertexArray(circleVAO);
     glDrawArrays(GL_TRIANGLE_FAN, 0, NUM_CIRCLE_VERTS+2);
-    glDisableVertexAttribArray(a_position);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void drawWireCircle(GLfloat rad, glm::vec2 pos)
 {
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(pos, drawLayer));
-    mMat = scale(mMat, vec3(rad, rad, 0.0f));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, glm::value_ptr(mMat));
-    glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
-    glEnableVertexAttribArray(a_position);
-    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    setObject(pos, glm::vec2(1.0f, 0.0f), glm::vec2(rad));
+    bindVertexArray(circleVAO);
     glDrawArrays(GL_LINE_LOOP, 1, NUM_CIRCLE_VERTS);
-    glDisableVertexAttribArray(a_position);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void drawTriangleFan(GLfloat *vertData, GLuint vertCount, glm::vec2 pos)
 {
-    using namespace glm;
-    mat4 mMat = translate(globalTranslation, vec3(pos, drawLayer));
-    glUniformMatrix4fv(u_modelview, 1, GL_FALSE, value_ptr(mMat));
-    const GLfloat *data = vertData;
-    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, vertData);
-    glEnableVertexAttribArray(a_position);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, vertCount);
-    glDisableVertexAttribArray(a_position);
+    GLfloat* dst = streamRing.allocate(2*vertCount);
+    memcpy(dst, vertData, sizeof(GLfloat)*2*vertCount);
+    GLint first = streamCommit();
+    setObject(pos, glm::vec2(1.0f, 0.0f), glm::vec2(1.0f));
+    glDrawArrays(GL_TRIANGLE_FAN, first, vertCount);
+}
+
+//-------------------//
+// Satellite Drawing //
+//-------------------//
+// --PURPOSE--
+// Make room in the atlas for a number of planet slots. Growing it
+// starts the buffer over, so every slot is uploaded again.
+static void reserveAtlas(int slots)
+{
+    if (slots <= atlasSlots) return;
+    int nslots = (atlasSlots < PLANET_CAPACITY) ? PLANET_CAPACITY
+                                                : atlasSlots;
+    while (nslots < slots) nslots *= 2;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, atlasVBO);
+    glBufferData(GL_COPY_WRITE_BUFFER,
+                 sizeof(GLfloat)*2*PLANET_ATLAS_VERTS*nslots,
+                 NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    atlasSlots = nslots;
+    planetVersions.assign(nslots, 0);
+    planetEdits.assign(nslots, 0);
+}
+
+// --PURPOSE--
+// Copy points of a planet into its atlas slot.
+// --PARAMETERS--
+// first, count:    Run of points in the planet data. The closing point
+//                  repeats the first rim point, the atlas leaves it out.
+static void uploadAtlas(int slot, const GLfloat* data, int first, int count)
+{
+    if (first+count > PLANET_ATLAS_VERTS) count = PLANET_ATLAS_VERTS-first;
+    if (count <= 0) return;
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    sizeof(GLfloat)*2*(slot*PLANET_ATLAS_VERTS+first),
+                    sizeof(GLfloat)*2*count,
+                    data+2*first);
+}
+
+// --PURPOSE--
+// Bring the atlas up to date with the planets. A slot is uploaded
+// whole when the planet's meshVersion moves on, and only where craters
+// moved points, one glBufferSubData per run, when its editVersion did.
+static void syncAtlas(const SimThread::planetView* planets, int count)
+{
+    reserveAtlas(count);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, atlasVBO);
+    for (int p = 0; p < count; ++p)
+    {
+        const SimThread::planetView& pl = planets[p];
+        const GLfloat* data = pl.outline;
+        if (!pl.alive)
+        {
+            planetVersions[p] = 0;
+            continue;
+        }
+        if (planetVersions[p] != pl.meshVersion)
+        {
+            uploadAtlas(p, data, 0, PLANET_ATLAS_VERTS);
+            planetVersions[p] = pl.meshVersion;
+            planetEdits[p] = pl.editVersion;
+            continue;
+        }
+        if (planetEdits[p] == pl.editVersion) continue;
+
+        int slot = 0;
+        while (slot < NUM_PLANET_VERTS+2)
+        {
+            if (!pl.editedSince(slot, planetEdits[p]))
+            {
+                ++slot;
+                continue;
+            }
+            int first = slot;
+            while (slot < NUM_PLANET_VERTS+2
+                   && pl.editedSince(slot, planetEdits[p]))
+                ++slot;
+            uploadAtlas(p, data, first, slot-first);
+        }
+        planetEdits[p] = pl.editVersion;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// Angle a fraction of the way from a0 to a1, the short way around:
+static float blendAngle(float a0, float a1, float alpha)
+{
+    float d = a1-a0;
+    if (d > PI) d -= TAU;
+    else if (d < -PI) d += TAU;
+    return a0+alpha*d;
+}
+
+// --PURPOSE--
+// Draw every planet in a snapshot: all the fills in one multi-draw, then
+// all the outlines in another, however many planets there are.
+// --PARAMETERS--
+// alpha:   How far to blend from where the planets were before the
+//          snapshot's tick to where they are, see SimThread::blend.
+void drawPlanets(const SimThread::snapshot& snap, float alpha)
+{
+    if (GL_INVALID_VALUE == atlasVAO) return;
+    const SimThread::planetView* planets = snap.planets.data();
+    int count = int(snap.planets.size());
+    syncAtlas(planets, count);
+
+    // Placement and color of each planet drawn, and the draw lists:
+    planetData.resize(PLANET_DATA_FLOATS*atlasSlots);
+    planetFillCounts.clear();
+    planetLineCounts.clear();
+    planetFillFirst.clear();
+    planetLineFirst.clear();
+    planetBaseVertex.clear();
+    for (int p = 0; p < count; ++p)
+    {
+        const SimThread::planetView& pl = planets[p];
+        // Don't draw a planet that doesn't exist:
+        if (0 == planetVersions[p]) continue;
+
+        glm::vec2 pos = pl.prevPos+alpha*(pl.pos-pl.prevPos);
+        float orient = blendAngle(pl.prevOrient, pl.orient, alpha);
+        GLfloat* d = &planetData[PLANET_DATA_FLOATS*p];
+        d[0] = pos[0];
+        d[1] = pos[1];
+        d[2] = cos(orient);
+        d[3] = sin(orient);
+        d[4] = pl.color[0];
+        d[5] = pl.color[1];
+        d[6] = pl.color[2];
+        d[7] = 1.0f;
+
+        planetFillCounts.push_back(NUM_PLANET_VERTS+2);
+        planetLineCounts.push_back(NUM_PLANET_VERTS);
+        planetFillFirst.push_back((const GLvoid*)0);
+        planetLineFirst.push_back((const GLvoid*)sizeof(GLushort));
+        planetBaseVertex.push_back(p*PLANET_ATLAS_VERTS);
+    }
+    GLsizei drawCount = GLsizei(planetBaseVertex.size());
+    if (0 == drawCount) return;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, planetDataVBO);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(GLfloat)*planetData.size(),
+                 &planetData[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, planetDataTBO);
+
+    glUniform1i(u_fromAtlas, GL_TRUE);
+    bindVertexArray(atlasVAO);
+
+    // We'll have to come up with layer constants later.
+    setDrawLayer(0);
+    setDrawColor(glm::vec4(1.0f, 1.0f, 1.0f, 0.5f));
+    setLayerObject();
+    glMultiDrawElementsBaseVertex(GL_TRIANGLE_FAN, &planetFillCounts[0],
+                                  GL_UNSIGNED_SHORT, &planetFillFirst[0],
+                                  drawCount, &planetBaseVertex[0]);
+
+    setDrawLayer(1);
+    setDrawColor(glm::vec4(1.0f));
+    setLayerObject();
+    glMultiDrawElementsBaseVertex(GL_LINE_LOOP, &planetLineCounts[0],
+                                  GL_UNSIGNED_SHORT, &planetLineFirst[0],
+                                  drawCount, &planetBaseVertex[0]);
+
+    glUniform1i(u_fromAtlas, GL_FALSE);
+}
+
+// --PURPOSE--
+// Draw every bullet in a snapshot with one instanced draw. The center,
+// radius and color of each bullet are packed straight into the stream
+// ring and scale the shared circle mesh in the vertex shader.
+// --PARAMETERS--
+// alpha:   How far to blend from where the bullets were before the
+//          snapshot's tick to where they are, see SimThread::blend.
+void drawBullets(const SimThread::snapshot& snap, float alpha)
+{
+    int count = int(snap.posX.size());
+    if (0 == count) return;
+
+    GLfloat* inst = streamRing.allocate(BULLET_INSTANCE_FLOATS*count);
+    for (int i = 0; i < count; ++i, inst += BULLET_INSTANCE_FLOATS)
+    {
+        inst[0] = snap.prevX[i]+alpha*(snap.posX[i]-snap.prevX[i]);
+        inst[1] = snap.prevY[i]+alpha*(snap.posY[i]-snap.prevY[i]);
+        inst[2] = snap.rad[i];
+        inst[3] = snap.color[i][0];
+        inst[4] = snap.color[i][1];
+        inst[5] = snap.color[i][2];
+    }
+    GLintptr offset = streamRing.commit();
+
+    // The circle mesh per vertex, the bullets per instance:
+    if (GL_INVALID_VALUE == bulletVAO)
+    {
+        bulletVAO = createMeshVAO(circleVBO);
+        glEnableVertexAttribArray(a_offset);
+        glVertexAttribDivisor(a_offset, 1);
+        glEnableVertexAttribArray(a_tint);
+        glVertexAttribDivisor(a_tint, 1);
+    }
+    bindVertexArray(bulletVAO);
+    bindRingBuffer();
+    GLsizei stride = sizeof(GLfloat)*BULLET_INSTANCE_FLOATS;
+    glVertexAttribPointer(a_offset, 3, GL_FLOAT, GL_FALSE, stride,
+                          (const GLvoid*)offset);
+    glVertexAttribPointer(a_tint, 3, GL_FLOAT, GL_FALSE, stride,
+                          (const GLvoid*)(offset+sizeof(GLfloat)*3));
+
+    setDrawLayer(2);
+    setDrawColor(glm::vec4(1.0f));
+    setLayerObject();
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, NUM_CIRCLE_VERTS+2, count);
+}
+
+// Order debug commands so each run of one layer, color and GL mode
+// draws at once. Filled triangles go before lines on the same layer:
+static bool debugOrder(const DebugDraw::command& a,
+                       const DebugDraw::command& b)
+{
+    if (a.layer != b.layer) return a.layer < b.layer;
+    bool aFill = (DEBUG_TRIANGLE == a.shape);
+    bool bFill = (DEBUG_TRIANGLE == b.shape);
+    if (aFill != bFill) return aFill;
+    for (int k = 0; k < 4; ++k)
+        if (a.color[k] != b.color[k]) return a.color[k] < b.color[k];
+    return false;
+}
+
+// Whether two sorted commands can share a glDrawArrays:
+static bool debugSameRun(const DebugDraw::command& a,
+                         const DebugDraw::command& b)
+{
+    return !debugOrder(a, b) && !debugOrder(b, a);
+}
+
+// Vertices a debug command turns into:
+static int debugVertices(DebugShape shape)
+{
+    return (DEBUG_TRIANGLE == shape) ? 3
+         : (DEBUG_CIRCLE == shape) ? 2*NUM_CIRCLE_VERTS : 2;
+}
+
+// --PURPOSE--
+// Flush everything recorded in DebugDraw since the last frame. All the
+// vertices are written into the stream ring at once, then each run of
+// commands with the same layer, color and mode is one draw call.
+void drawDebug()
+{
+    DebugDraw::take(debugCommands);
+    if (debugCommands.empty()) return;
+    std::stable_sort(debugCommands.begin(), debugCommands.end(), debugOrder);
+
+    // Triangles as GL_TRIANGLES, lines and circles as GL_LINES:
+    int vertCount = 0;
+    for (size_t i = 0; i < debugCommands.size(); ++i)
+        vertCount += debugVertices(debugCommands[i].shape);
+    GLfloat* dst = streamRing.allocate(2*vertCount);
+    for (size_t i = 0; i < debugCommands.size(); ++i)
+    {
+        const DebugDraw::command& cmd = debugCommands[i];
+        if (DEBUG_CIRCLE == cmd.shape)
+        {
+            for (int v = 0; v < NUM_CIRCLE_VERTS; ++v)
+            {
+                float a0 = TAU*v/NUM_CIRCLE_VERTS;
+                float a1 = TAU*(v+1)/NUM_CIRCLE_VERTS;
+                *dst++ = cmd.data[0]+cmd.data[2]*cosf(a0);
+                *dst++ = cmd.data[1]+cmd.data[2]*sinf(a0);
+                *dst++ = cmd.data[0]+cmd.data[2]*cosf(a1);
+                *dst++ = cmd.data[1]+cmd.data[2]*sinf(a1);
+            }
+        }
+        else
+        {
+            int floats = 2*debugVertices(cmd.shape);
+            memcpy(dst, cmd.data, sizeof(GLfloat)*floats);
+            dst += floats;
+        }
+    }
+    GLint first = streamCommit();
+
+    size_t i = 0;
+    while (i < debugCommands.size())
+    {
+        const DebugDraw::command& head = debugCommands[i];
+        GLint count = 0;
+        for (; i < debugCommands.size()
+               && debugSameRun(head, debugCommands[i]); ++i)
+            count += debugVertices(debugCommands[i].shape);
+
+        setDrawLayer(head.layer);
+        setDrawColor(head.color);
+        setLayerObject();
+        glDrawArrays((DEBUG_TRIANGLE == head.shape) ? GL_TRIANGLES : GL_LINES,
+                     first, count);
+        first += count;
+    }
 }
 
 //---------------//
@@ -160,26 +546,49 @@ void setDrawLayer(GLuint layer)
 
 void setDrawColor(glm::vec3 color)
 {
-    glUniform4fv(u_color, 1, glm::value_ptr(glm::vec4(color, 1.0f)));
+    setDrawColor(glm::vec4(color, 1.0f));
 }
 
 void setDrawColor(glm::vec4 color)
 {
+    if (drawState.colorSet
+        && 0 == memcmp(&drawState.color, &color, sizeof(color))) return;
     glUniform4fv(u_color, 1, glm::value_ptr(color));
+    drawState.color = color;
+    drawState.colorSet = true;
 }
 
+// Look up the shader inputs. Must come before any VBO is created, since
+// the vertex arrays made with them record the attribute locations.
 void setShaderHandles(GLuint shaderID)
 {
     a_position = glGetAttribLocation(shaderID, "position");
-    u_modelview = glGetUniformLocation(shaderID, "modelview");
-    u_viewport = glGetUniformLocation(shaderID, "viewport");
+    a_offset = glGetAttribLocation(shaderID, "offset");
+    a_tint = glGetAttribLocation(shaderID, "tint");
+    u_object = glGetUniformLocation(shaderID, "object");
     u_projection = glGetUniformLocation(shaderID, "projection");
     u_color = glGetUniformLocation(shaderID, "color");
+    u_fromAtlas = glGetUniformLocation(shaderID, "fromAtlas");
+    u_atlasVerts = glGetUniformLocation(shaderID, "atlasVerts");
+    u_planets = glGetUniformLocation(shaderID, "planets");
+    glUniform1i(u_fromAtlas, GL_FALSE);
+    glUniform1i(u_atlasVerts, PLANET_ATLAS_VERTS);
+    glUniform1i(u_planets, 0);      // texture unit
+
+    // Everything but the bullets draws one object at a time, untinted:
+    glVertexAttrib3f(a_offset, 0.0f, 0.0f, 1.0f);
+    glVertexAttrib4f(a_tint, 1.0f, 1.0f, 1.0f, 1.0f);
+
+    // A new program starts with its own uniforms:
+    drawState.colorSet = false;
+    drawState.objectSet = false;
 }
 
+// Game coordinates to clip space, with globalTranslation folded in so
+// the shader does one matrix multiply per vertex:
 void setCoordinateSystem(GLfloat xVal, GLfloat yVal)
 {
-    glm::mat4 pMat = glm::ortho(0.0f, xVal, 0.0f, yVal);
+    glm::mat4 pMat = glm::ortho(0.0f, xVal, 0.0f, yVal)*globalTranslation;
     glUniformMatrix4fv(u_projection,
                        1, GL_FALSE,
                        glm::value_ptr(pMat));
@@ -188,91 +597,39 @@ void setCoordinateSystem(GLfloat xVal, GLfloat yVal)
 //-------------------------------//
 // Vertex Buffer Object Creation //
 //-------------------------------//
-void genRandomFractalMap(float range, int x0, int xn, float *map) 
+// --PURPOSE--
+// Set up the planet atlas: the shared index list, the vertex array that
+// reads the atlas through it, and the texture buffer of per-planet
+// data. The atlas itself is sized by the first drawPlanets.
+void createPlanetAtlas()
 {
-    int xm = (xn+x0)/2;
-    float val = range*(float(rand())/RAND_MAX-0.5); 
-    
-    if (xn - x0 <= 5)
-    {
-        for (int i = x0; i < xn; ++i)
-        {
-            map[i] = (map[x0] + map[xn])/2;
-        }
-    }
-    else
-    {   
-        map[xm] = map[xm] + val + (map[x0]+map[xn])/2;
-        genRandomFractalMap(range*0.5f,x0,xm,map);
-        genRandomFractalMap(range*0.5f,xm,xn,map);
-    }   
-}
-
-GLfloat *createPlanetData(GLfloat maxRad)
-{
-    GLfloat *ranMap = new GLfloat[NUM_PLANET_VERTS];
-    for (int i = 0; i < NUM_PLANET_VERTS; ++i) ranMap[i] = 0;
-    genRandomFractalMap(1.0f, 0, NUM_PLANET_VERTS-1, ranMap);
-
-    double theta = 0.0;
-    double radIncrement = 2.0*PI/double(NUM_PLANET_VERTS);
-
-    GLfloat *planetData = new GLfloat[2*NUM_PLANET_VERTS+4];
-    // Center of planet.
-    planetData[0] = 0.0f;   // x
-    planetData[1] = 0.0f;   // y
-    GLfloat maxLen = 0.0f;
-    // The rest of the points along the circumference.
-    for (int i = 0; i < NUM_PLANET_VERTS; ++i)
-    {   
-        // i = NUM_PLANET_VERTS-1
-        // planetData[2*NUM_PLANET_VERTS]
-        // planetData[2*NUM_PLANET_VERTS+1]
-
-           //planetData[2*i+2] = cos(theta); // x
-        //planetData[2*i+3] = sin(theta); // y
-
-           planetData[2*i+2] = cos(theta)*(1+ranMap[i]); // x
-        planetData[2*i+3] = sin(theta)*(1+ranMap[i]); // y
-        theta += radIncrement;
-
-        // Find the length of this vector:
-        using glm::distance;
-        using glm::vec2;
-        GLfloat len =  distance(vec2(planetData[2*i+2], planetData[2*i+3]), vec2(0.0f));
-        if (len > maxLen) maxLen = len; 
-    }       
-
-    for (int i = 1; i <= NUM_PLANET_VERTS; ++i)
-    {   
-        planetData[2*i] *= (maxRad/maxLen);
-        planetData[2*i+1] *= (maxRad/maxLen);
-    }
-    
-    // Complete the circle.
-    planetData[2*NUM_PLANET_VERTS+2] = planetData[2]; // x
-    planetData[2*NUM_PLANET_VERTS+3] = planetData[3]; // y
-    
-    return planetData;
-    
-}
-
-       
-GLuint createPlanetVBO(GLfloat *planetData){
-
-    GLuint planetBuffer;
-
-    // Initialize circle vertex buffer object.
-    glGenBuffers(1, &planetBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, planetBuffer);
-    glBufferData(GL_ARRAY_BUFFER,
-                 sizeof(GLfloat)*(2*NUM_PLANET_VERTS+4),
-                 planetData,
+    if (GL_INVALID_VALUE != atlasVAO) return;
+
+    // Center, rim, first rim point again for the fan. The loop is the
+    // same list without the ends:
+    GLushort indices[NUM_PLANET_VERTS+2];
+    for (int i = 0; i <= NUM_PLANET_VERTS; ++i) indices[i] = GLushort(i);
+    indices[NUM_PLANET_VERTS+1] = 1;
+
+    glGenBuffers(1, &atlasVBO);
+    glGenBuffers(1, &atlasIBO);
+    atlasVAO = createMeshVAO(atlasVBO);
+    // The element buffer binding belongs to the vertex array:
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, atlasIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
                  GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    //delete [] planetData;
-    return planetBuffer;
+    reserveAtlas(PLANET_CAPACITY);
+
+    glGenBuffers(1, &planetDataVBO);
+    glGenTextures(1, &planetDataTBO);
+    glBindBuffer(GL_TEXTURE_BUFFER, planetDataVBO);
+    glBufferData(GL_TEXTURE_BUFFER,
+                 sizeof(GLfloat)*PLANET_DATA_FLOATS*PLANET_CAPACITY,
+                 NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, planetDataTBO);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, planetDataVBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
 }
 
 void createCircleVBO()
@@ -288,28 +645,77 @@ void createCircleVBO()
     circleData[0] = 0.0f;   // x
     circleData[1] = 0.0f;   // y
     // The rest of the points along the circumference.
-    for (int i = 1; i < NUM_CIRCLE_VERTS; ++i, theta += radIncrement)
+    for (int i = 1; i <= NUM_CIRCLE_VERTS; ++i, theta += radIncrement)
     {
         circleData[2*i] = cos(theta);   // x
         circleData[2*i+1] = sin(theta); // y
     }
     // Complete the circle.
-    circleData[2*NUM_CIRCLE_VERTS] = circleData[2];  // x
-    circleData[2*NUM_CIRCLE_VERTS+1] = circleData[3];  // y
+    circleData[2*NUM_CIRCLE_VERTS+2] = circleData[2];  // x
+    circleData[2*NUM_CIRCLE_VERTS+3] = circleData[3];  // y
 
     // Initialize circle vertex buffer object.
     glGenBuffers(1, &circleVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
+    bindArrayBuffer(circleVBO);
     glBufferData(GL_ARRAY_BUFFER,
                  sizeof(GLfloat)*(2*(NUM_CIRCLE_VERTS+2)),
                  circleData,
                  GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    circleVAO = createMeshVAO(circleVBO);
 
     // Local memory no longer needed.
     delete [] circleData;
 }
 
+// Set up the ring all per-frame geometry is streamed through:
+void createStreamBuffer()
+{
+    if (GL_INVALID_VALUE != streamVAO) return;
+    streamRing.create(sizeof(GLfloat)*STREAM_BUFFER_FLOATS);
+    glGenVertexArrays(1, &streamVAO);
+    bindVertexArray(streamVAO);
+    glEnableVertexAttribArray(a_position);
+    bindStreamArray();
+}
+
+//--------------//
+// Frame Bounds //
+//--------------//
+// Call before the first draw of a frame. Waits, if need be, until the
+// GPU is done with the part of the stream ring this frame will write.
+void beginDrawFrame()
+{
+    streamRing.beginFrame();
+}
+
+// Call after the last draw of a frame, before swapping buffers:
+void endDrawFrame()
+{
+    streamRing.endFrame();
+}
+
+// --PURPOSE--
+// Set how many display refreshes a buffer swap waits for: 1 for vsync,
+// 0 to swap at once. Needs a current context. Prints nothing, whether a
+// failure matters is up to the caller.
+// --RETURNS--
+// False if the driver offers no way to set it, or can't set this value.
+bool setSwapInterval(int interval)
+{
+    if (GLXEW_EXT_swap_control)
+    {
+        glXSwapIntervalEXT(glXGetCurrentDisplay(), glXGetCurrentDrawable(),
+                           interval);
+        return true;
+    }
+    if (GLXEW_MESA_swap_control)
+        return 0 == glXSwapIntervalMESA(interval);
+    // SGI only takes intervals of 1 and up:
+    if (GLXEW_SGI_swap_control && 0 < interval)
+        return 0 == glXSwapIntervalSGI(interval);
+    return false;
+}
+
 void createSquareVBO()
 {
     // Square is common, check if it exists:
@@ -320,23 +726,23 @@ void createSquareVBO()
         -0.5f, -0.5f,   // bottom left corner
          0.5f, -0.5f,   // bottom right corner
         -0.5f,  0.5f,   // top left corner
-         0.5f,  0.5f,   // top right corner 
+         0.5f,  0.5f,   // top right corner
         // GL_LINE_LOOP
         -0.5f, -0.5f,   // bottom left corner
          0.5f, -0.5f,   // bottom right corner
-         0.5f,  0.5f,   // top right corner 
+         0.5f,  0.5f,   // top right corner
         -0.5f,  0.5f,   // top left corner
     };
 
     // create the square vbo
     glGenBuffers(1, &squareVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
+    bindArrayBuffer(squareVBO);
     // Associate square_vertex_buffer with squareData.
     glBufferData(GL_ARRAY_BUFFER,
                  sizeof(GLfloat)*16,
                  squareData,
                  GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    squareVAO = createMeshVAO(squareVBO);
 }
 
 //----------------------------------//
@@ -344,7 +750,19 @@ void createSquareVBO()
 //----------------------------------//
 void cleanBuffers()
 {
+    bindVertexArray(0);
+    bindArrayBuffer(0);
+    if (GL_INVALID_VALUE != circleVAO) glDeleteVertexArrays(1, &circleVAO);
+    if (GL_INVALID_VALUE != squareVAO) glDeleteVertexArrays(1, &squareVAO);
+    if (GL_INVALID_VALUE != bulletVAO) glDeleteVertexArrays(1, &bulletVAO);
+    if (GL_INVALID_VALUE != streamVAO) glDeleteVertexArrays(1, &streamVAO);
     if (GL_INVALID_VALUE != circleVBO) glDeleteBuffers(1, &circleVBO);
     if (GL_INVALID_VALUE != squareVBO) glDeleteBuffers(1, &squareVBO);
+    streamRing.destroy();
+    if (GL_INVALID_VALUE != atlasVAO) glDeleteVertexArrays(1, &atlasVAO);
+    if (GL_INVALID_VALUE != atlasVBO) glDeleteBuffers(1, &atlasVBO);
+    if (GL_INVALID_VALUE != atlasIBO) glDeleteBuffers(1, &atlasIBO);
+    if (GL_INVALID_VALUE != planetDataTBO) glDeleteTextures(1, &planetDataTBO);
+    if (GL_INVALID_VALUE != planetDataVBO) glDeleteBuffers(1, &planetDataVBO);
+    planetVersions.assign(planetVersions.size(), 0);
 }
-
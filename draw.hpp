@@ -7,17 +7,20 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "constants.hpp"
-#include "satellite.hpp"
+#include "SimThread.hpp"
+#include "DebugDraw.hpp"
+#include "StreamBuffer.hpp"
 
-// Planet specific:
-void drawPlanet(GLuint planetVBO, glm::vec2 pos, GLfloat rot);
-void drawWirePlanet(GLuint planetVBO, glm::vec2 pos, GLfloat rot);
-GLuint createPlanetVBO(GLfloat *planetData);
-GLfloat *createPlanetData(GLfloat maxRad);
-void genRandomFractalMap(float range, int x0, int xn, float *map);
+// Satellites:
+void drawPlanets(const SimThread::snapshot& snap, float alpha);
+void drawBullets(const SimThread::snapshot& snap, float alpha);
+
+// Debug visualization recorded by the simulation, see DebugDraw:
+void drawDebug();
 
 // Draw commands:
 void drawLine(glm::vec2 p0, glm::vec2 p1);
+void drawLineStrip(const glm::vec2* points, int count);
 void drawSquare(GLfloat width, glm::vec2 pos);
 void drawWireSquare(GLfloat width, glm::vec2 pos);
 void drawRectangle(GLfloat width, GLfloat height, glm::vec2 pos);
@@ -32,10 +35,17 @@ void setDrawColor(glm::vec3 color);
 void setDrawColor(glm::vec4 color);
 void setShaderHandles(GLuint shaderID);
 void setCoordinateSystem(GLfloat xVal, GLfloat yVal);
+bool setSwapInterval(int interval);
 
 // Common buffer creation:
 void createCircleVBO();
 void createSquareVBO();
+void createStreamBuffer();
+void createPlanetAtlas();
+
+// Frame bounds, around all the draws of a frame:
+void beginDrawFrame();
+void endDrawFrame();
 
 // Buffer cleanup -- Must be called at end of program!
 void cleanBuffers();
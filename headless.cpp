@@ -0,0 +1,66 @@
+// headless.cpp
+// Runs a scenario without a window, as fast as possible, and reports
+// the simulation throughput.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "World.hpp"
+#include "Scenario.hpp"
+#include "GravityKernel.hpp"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <scenario> [ticks] [threads] [hz]\n"
+                        "threads: 0 uses one per core\n"
+                        "hz:      steps per simulated second\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long ticks = (argc > 2) ? atol(argv[2]) : 1000;
+    int threads = (argc > 3) ? atoi(argv[3]) : 0;
+    float hz = (argc > 4) ? float(atof(argv[4])) : float(SIM_HZ);
+
+    // Workers besides the main thread, -1 for one per core:
+    World *world = new World(threads-1);
+    if (!loadScenario(argv[1], *world))
+    {
+        delete world;
+        return EXIT_FAILURE;
+    }
+    if (hz > 0.0f) world->stepDt = 1.0f/hz;
+    int startBullets = world->bullets.count();
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (long t = 0; t < ticks; ++t)
+    {
+        world->step();
+        // Nobody draws the impacts:
+        world->impacts.clear();
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1-t0).count();
+
+    fprintf(stdout,
+            "scenario:     %s\n"
+            "gravity:      %s\n"
+            "collision:    %s\n"
+            "threads:      %d\n"
+            "ticks:        %ld\n"
+            "step:         %f s\n"
+            "bullets:      %d -> %d\n"
+            "seconds:      %f\n"
+            "ticks/second: %f\n",
+            argv[1],
+            GravityKernel::pathName(GravityKernel::getPath()),
+            world->exactCollision ? "exact" : "distance field",
+            world->threadCount(),
+            ticks,
+            world->stepDt,
+            startBullets, world->bullets.count(),
+            seconds,
+            (seconds > 0.0) ? ticks/seconds : 0.0);
+
+    delete world;
+    return EXIT_SUCCESS;
+}
@@ -1,17 +1,26 @@
 // main.cpp
 #include <cstdio>
+#include <vector>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <GL/freeglut.h>
 #include "shaders/loadShaders.h"
 #include "draw.hpp"
-#include "CollisionDetector.hpp"
-#include "satellite.hpp"
-
-static planet planets[MAX_PLANET]; 
-static bullet bullets[MAX_BULLET];
-static int pIndex = 0;
-static int bIndex = 0;
+#include "FrameScheduler.hpp"
+#include "GravityKernel.hpp"
+#include "World.hpp"
+
+// All game state, stepped on its own thread. Once that starts, the
+// world is only changed through sim.post() and only seen through
+// sim.latest():
+static World world;
+static SimThread sim(world);
+
+// Frame pacing, see scheduleFrame():
+static FrameScheduler frames;
+static bool frameTimerPending = false;
+void scheduleFrame();
+void setFrameMode(FrameMode mode);
 
 // To turn on shader program:
 static GLuint shaderID = 0;
@@ -19,15 +28,31 @@ static GLuint shaderID = 0;
 // Dimensions:
 static int windowWidth  = 800;
 static int windowHeight = 800;
-static float gameWidth  = 150.0f;
-static float gameHeight = 150.0f;
+static float gameWidth  = world.width;
+static float gameHeight = world.height;
 
 // Mouse coordinates:
 static glm::vec2 mouse;
 
 // Key state buffer:
 static bool keyState[256] = {false};
-void onKeyPress(unsigned char key, int mX, int mY) { keyState[key] = true; }
+void onKeyPress(unsigned char key, int mX, int mY)
+{
+    keyState[key] = true;
+    // Toggle bullet-on-bullet attraction:
+    if ('g' == key)
+        sim.post([](World& w) { w.bulletGravity = !w.bulletGravity; });
+    // Toggle the cached planet gravity field:
+    if ('f' == key)
+        sim.post([](World& w) { w.useGravityField = !w.useGravityField; });
+    // Toggle exact outline collision, to check the distance fields:
+    if ('c' == key)
+        sim.post([](World& w) { w.exactCollision = !w.exactCollision; });
+    // Toggle collision debug drawing:
+    if ('d' == key) DebugDraw::enable(!DebugDraw::enabled());
+    // Cycle frame pacing: capped, vsync, uncapped:
+    if ('v' == key) setFrameMode(FrameMode((frames.getMode()+1)%3));
+}
 void onKeyRelease(unsigned char key, int mX, int mY) { keyState[key] = false; }
 
 // Convert mouse coordinates to game coordinates:
@@ -43,35 +68,15 @@ glm::vec2 mouseToGame()
 // Add a bullet to the scene:
 void addBullet()
 {
-    // Initialize a bullet to be added to the scene:
-    bullets[bIndex].pos = mouseToGame();
-    bullets[bIndex].vel = glm::vec2(0.0f);
-    bullets[bIndex].rad = 0.25f;
-    bullets[bIndex].mass = 10.0f;
-    bullets[bIndex].startTime = glutGet(GLUT_ELAPSED_TIME)/1000.0f;
-    bullets[bIndex].onPlanet = false;
-
-    // Correct the bullet index:
-    if (++bIndex >= MAX_BULLET) bIndex = 0;
+    glm::vec2 pos = mouseToGame();
+    sim.post([pos](World& w) { w.addBullet(pos, glm::vec2(0.0f)); });
 }
 
 // Add a planet to the scene:
 void addPlanet()
 {
-    // Initialize a planet to be added to the scene:
-    planets[pIndex].orient = (rand()%360)*(PI/180.0f);
-    planets[pIndex].rotSpeed = 
-        float((((rand()%MAX_ROTATION)+1)-MAX_ROTATION/2))/1000.0f;
-    planets[pIndex].pos = mouseToGame();
-    planets[pIndex].maxRad = (rand()%10)+10.0f;
-    planets[pIndex].changePlanetGraphic(planets[pIndex].maxRad);
-    planets[pIndex].color = glm::vec3(((rand()%100)+1)/100.0f,
-                                      ((rand()%100)+1)/100.0f,
-                                      ((rand()%100)+1)/100.0f);
-
-    // Correct the planet index:
-    if (++pIndex >= MAX_PLANET) pIndex = 0;
-
+    glm::vec2 pos = mouseToGame();
+    sim.post([pos](World& w) { w.addPlanet(pos); });
 }
 
 // Handle mouse events:
@@ -88,68 +93,38 @@ void processMouseActiveMotion(int button, int state, int xx, int yy)
 
 }
 
-void updatePlanets()
+// While 'p' is held, show where shots fired from the mouse in a ring
+// of directions would go. The simulation thread works the paths out
+// after each tick, they show up in a later snapshot:
+void drawPreview(const SimThread::snapshot& snap)
 {
-    for (int p = 0; p < MAX_PLANET; ++p)
+    using glm::vec2;
+    if (!keyState['p'])
     {
-        if (0.0f == planets[p].maxRad) continue;
-        // Spin the planet a bit:
-        planets[p].orient += planets[p].rotSpeed;
-        if (planets[p].orient >= TAU) planets[p].orient -= TAU;
-        else if (planets[p].orient <= 0.0f) planets[p].orient += TAU;
+        sim.setPreview(NULL, NULL, 0);
+        return;
     }
-}
 
-void updateBullets()
-{
-    // namespace resolution
-    using namespace glm;
+    vec2 pos[PREVIEW_SHOTS];
+    vec2 vel[PREVIEW_SHOTS];
+    for (int i = 0; i < PREVIEW_SHOTS; ++i)
+    {
+        float angle = float(TAU)*i/PREVIEW_SHOTS;
+        pos[i] = mouseToGame();
+        vel[i] = (0.5f*MAX_BULLET_SPEED)*vec2(cos(angle), sin(angle));
+    }
+    sim.setPreview(pos, vel, PREVIEW_SHOTS);
 
-    for (int b = 0; b < MAX_BULLET; ++b)
+    setDrawLayer(2);
+    for (size_t i = 0; i < snap.preview.size(); ++i)
     {
-        // Don't update bullets that don't exist:
-        if (0.0f == bullets[b].rad || true == bullets[b].onPlanet) continue;
-
-        // Sum of gravitational forces:
-        vec2 sum = vec2(0.0f);
-        for (int p = 0; p < MAX_PLANET; ++p)
-        {   
-            // Optimize distance check:
-            GLfloat dx = planets[p].pos[0] - bullets[b].pos[0];
-            GLfloat dy = planets[p].pos[1] - bullets[b].pos[1];
-            GLfloat sqrDis = dx*dx + dy*dy;
-            GLfloat sqrRadSum = planets[p].maxRad + bullets[b].rad;
-            sqrRadSum *= sqrRadSum;
-
-            // If bullet is in relative area of a planet:
-            //float r = distance(planets[p].pos, bullets[b].pos);
-            //if (r <= planets[p].maxRad+bullets[b].rad)
-            if (sqrDis < sqrRadSum)
-            {
-                // Check if the bullet is colliding with the planet:
-                if (CollisionDetector::checkCollision(planets[p], bullets[b]))
-                {
-                    bullets[b].vel = vec2(0.0f);
-                    bullets[b].startTime = glutGet(GLUT_ELAPSED_TIME)/1000.0f;
-                    bullets[b].onPlanet = true;
-                    bullets[b].rad = 0.0f;
-                    break;
-                }
-            }
-            // Calculate the sum of all forces of gravity:
-            vec2 ab = normalize(planets[p].pos-bullets[b].pos);
-            float fg = (GRAVITATIONAL*planets[p].mass*bullets[b].mass)/(sqrDis);
-            sum = sum+fg*ab;
-        }
-    
-        if (true == bullets[b].onPlanet) continue;
-        float t1 = glutGet(GLUT_ELAPSED_TIME)/1000.0f;
-        float t = t1 - bullets[b].startTime;
-        bullets[b].vel = sum*t + bullets[b].vel;
-        // Maximum velocity?
-        if (length(bullets[b].vel) > MAX_BULLET_SPEED)
-            bullets[b].vel = MAX_BULLET_SPEED*normalize(bullets[b].vel);
-        bullets[b].pos = sum*t*t + bullets[b].vel*t+bullets[b].pos;
+        const World::trajectory& path = snap.preview[i];
+        setDrawColor(glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+        drawLineStrip(path.points.data(), int(path.points.size()));
+        // Mark where it would land:
+        if (-1 == path.planet) continue;
+        setDrawColor(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+        drawCircle(BULLET_RAD, path.points.back());
     }
 }
 
@@ -158,57 +133,102 @@ void keyboardEvents()
     if (keyState['b']) addBullet();
 }
 
-// Returns true if time for a game tick.
-bool timeForTick()
+// Prints frame times over the last second:
+void printFrameReport()
+{
+    FrameScheduler::report r;
+    if (!frames.takeReport(r)) return;
+    fprintf(stdout, "FPS:%d %s, work %.2f ms, slack mean %.2f min %.2f ms, "
+            "missed %d\n", int(r.frames/r.seconds+0.5f),
+            FrameScheduler::modeName(frames.getMode()), r.meanWork,
+            r.meanSlack, r.minSlack, r.missed);
+}
+
+void onFrameTimer(int value)
 {
-    static GLfloat t0 = 0.0f;
-    GLfloat t1 = glutGet(GLUT_ELAPSED_TIME)/1000.0f;
-    if (t1-t0 >= 1.0f/60.0f)
+    frameTimerPending = false;
+    if (FRAME_CAPPED != frames.getMode()) return;
+    // Woken early, e.g. by a frame drawn in between for the window system:
+    if (frames.untilDue() > std::chrono::milliseconds(FRAME_TIMER_MARGIN_MS))
     {
-        t0 = t1;
-        return true;
+        scheduleFrame();
+        return;
     }
-    else return false;
+    frames.waitForDeadline();
+    glutPostRedisplay();
 }
 
-// Prints the number of frames rendered in the last second.
-void printRoughFPS()
+// --PURPOSE--
+// Ask GLUT for the next frame. When capped, a timer fires a little before
+// the frame is due and the rest is slept exactly, since timers only
+// count whole milliseconds. Until then GLUT sleeps waiting for events,
+// so input is still handled and no CPU is spent. Otherwise the next
+// frame is asked for straight away, and in FRAME_VSYNC mode the buffer
+// swap does the waiting.
+void scheduleFrame()
 {
-    // frames per second
-    static GLfloat t0 = 0.0f;
-    static int frameCount = 1;
-    GLfloat t1 = glutGet(GLUT_ELAPSED_TIME)/1000.0f;
-    if (t1-t0 >= 1.0f)
+    if (FRAME_CAPPED != frames.getMode())
     {
-        // Print the number of frames counted in the last second.
-        fprintf(stdout, "FPS:%d\n", frameCount);
-        t0 = t1;
-        frameCount = 1;
+        glutPostRedisplay();
+        return;
     }
-    else ++frameCount;
+    if (frameTimerPending) return;
+    long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        frames.untilDue()).count()-FRAME_TIMER_MARGIN_MS;
+    frameTimerPending = true;
+    glutTimerFunc((0 < ms) ? unsigned(ms) : 0, onFrameTimer, 0);
+}
+
+// Switch frame pacing. Without a way to turn vsync on, stays capped.
+// Capped frames sleep on their own, so they don't care if the swap
+// interval can't be set:
+void setFrameMode(FrameMode mode)
+{
+    static bool uncappedNoticed = false;
+    if (!setSwapInterval((FRAME_VSYNC == mode) ? 1 : 0))
+    {
+        if (FRAME_VSYNC == mode)
+        {
+            fprintf(stderr, "Error: can't turn on vsync\n");
+            mode = FRAME_CAPPED;
+        }
+        else if (FRAME_UNCAPPED == mode && !uncappedNoticed)
+        {
+            fprintf(stdout, "Notice: no swap control, uncapped frames may "
+                    "still wait for vsync\n");
+            uncappedNoticed = true;
+        }
+    }
+    frames.setMode(mode);
+    fprintf(stdout, "Frame pacing: %s\n", FrameScheduler::modeName(mode));
+    scheduleFrame();
 }
 
 // Rendering and game logic.
 void renderScene()
 {
-    if (!timeForTick()) return;
+    frames.beginFrame();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glUseProgram(shaderID);
+    beginDrawFrame();
 
-    printRoughFPS();
+    printFrameReport();
     keyboardEvents();
-    updatePlanets();
-    updateBullets();
 
-    // Only draw planets that exist:
-    for (int p = 0; p < MAX_PLANET; ++p)
-        if (0.0f < planets[p].maxRad) planets[p].draw();
-    // Only draw bullets that exist:
-    for (int b = 0; b < MAX_BULLET; ++b)
-        if (0.0f < bullets[b].rad) bullets[b].draw();
+    // Blend between the last two ticks for the time the frame is drawn:
+    const SimThread::snapshot& snap = sim.latest();
+    float alpha = SimThread::blend(snap, SimThread::clock::now());
+    drawDebug();
+    drawPreview(snap);
+    drawPlanets(snap, alpha);
+    drawBullets(snap, alpha);
 
+    endDrawFrame();
     glUseProgram(0);
+    // Before the swap, which may wait for the display:
+    frames.endFrame();
     glutSwapBuffers();
+    scheduleFrame();
 }
 
 
@@ -230,9 +250,11 @@ void init()
 
     // Some drawing setup:
     glUseProgram(shaderID);
+    setShaderHandles(shaderID);
     createCircleVBO();
     createSquareVBO();
-    setShaderHandles(shaderID);
+    createStreamBuffer();
+    createPlanetAtlas();
     setCoordinateSystem(gameWidth, gameHeight);
     glUseProgram(0);
 }
@@ -251,8 +273,8 @@ int main(int argc, char *argv[])
     glutInit(&argc, argv);
     glutInitWindowSize(windowWidth, windowHeight);
     glutInitWindowPosition(0, 0);
-    glutInitContextVersion(3, 0); // OpenGL 3.0
-    glutInitContextFlags(GLUT_CORE_PROFILE); // set profile context
+    glutInitContextVersion(3, 3); // OpenGL 3.3, for instanced arrays
+    glutInitContextProfile(GLUT_CORE_PROFILE); // no deprecated calls
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
     glutCreateWindow("Scorched Space");
 
@@ -265,14 +287,18 @@ int main(int argc, char *argv[])
         exit(1);
     }   
     else fprintf(stdout, "GLEW initialized successfully\n");
+    fprintf(stdout, "Gravity kernel: %s\n",
+            GravityKernel::pathName(GravityKernel::getPath()));
+    fprintf(stdout, "Simulation threads: %d\n", world.threadCount());
 
     // initialize main program
     init();
+    setFrameMode(FRAME_CAPPED);
+    sim.start();
 
     // glut program loop
     glutDisplayFunc(renderScene);
     glutReshapeFunc(reshape);
-    glutIdleFunc(renderScene);
     glutPassiveMotionFunc(processMousePassiveMotion);
     glutMouseFunc(processMouseActiveMotion);
     glutKeyboardFunc(onKeyPress);
@@ -280,6 +306,7 @@ int main(int argc, char *argv[])
     glutMainLoop();
 
     // Some OpenGL clean up:
+    sim.stop();
     cleanBuffers();
     if (GL_TRUE == glIsProgram(shaderID)) glDeleteProgram(shaderID);
 
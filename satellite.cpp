@@ -1,4 +1,7 @@
+// satellite.cpp
 #include "satellite.hpp"
+#include <cmath>
+#include <cstdlib>
 
 //-----------------------------//
 // Planet Class Implementation //
@@ -15,12 +18,14 @@ planet::planet()
     this->pos = glm::vec2(0.0f);
     this->vel = glm::vec2(0.0f);
     this->color = glm::vec3(1.0f);
-    this->planetVBO = GL_INVALID_VALUE;
+    this->meshVersion = 0;
     this->planetData = NULL;
+    this->clearEdits();
+    this->updateWorldGeometry();
 }
 
 // 2-parameter constructor:
-planet::planet(GLfloat imaxRad, glm::vec2 ipos)
+planet::planet(float imaxRad, glm::vec2 ipos)
 {
     //fprintf(stdout, "Constructing satellite::planet: 0x%x...\n", this);
     this->orient = 0.0f;
@@ -31,7 +36,28 @@ planet::planet(GLfloat imaxRad, glm::vec2 ipos)
     this->vel = glm::vec2(0.0f);
     this->color = glm::vec3(1.0f);
     this->planetData = createPlanetData(this->maxRad);
-    this->planetVBO = createPlanetVBO(this->planetData);
+    this->meshVersion = 1;
+    this->clearEdits();
+    this->distanceField.build(this->planetData);
+    this->updateWorldGeometry();
+}
+
+// Copy constructor. Planets own their data, so it is copied too:
+planet::planet(const planet& other) : satellite(other)
+{
+    this->orient = other.orient;
+    this->rotSpeed = other.rotSpeed;
+    this->maxRad = other.maxRad;
+    this->meshVersion = other.meshVersion;
+    this->planetData = NULL;
+    if (NULL != other.planetData)
+    {
+        this->planetData = new float[2*NUM_PLANET_VERTS+4];
+        for (int i = 0; i < 2*NUM_PLANET_VERTS+4; ++i)
+            this->planetData[i] = other.planetData[i];
+    }
+    this->distanceField = other.distanceField;
+    this->copyWorldGeometry(other);
 }
 
 // Destructor:
@@ -41,57 +67,265 @@ planet::~planet()
     this->clean();
 }
 
-GLfloat* planet::getPlanetData() const
+// Assignment, see the copy constructor:
+planet& planet::operator=(const planet& other)
+{
+    if (this == &other) return *this;
+    planet copy(other);
+    satellite::operator=(copy);
+    this->orient = copy.orient;
+    this->rotSpeed = copy.rotSpeed;
+    this->maxRad = copy.maxRad;
+    this->meshVersion = copy.meshVersion;
+    this->distanceField = copy.distanceField;
+    this->copyWorldGeometry(copy);
+    float *data = this->planetData;
+    this->planetData = copy.planetData;
+    copy.planetData = data;
+    return *this;
+}
+
+float* planet::getPlanetData() const
 {
     return this->planetData;
 }
 
-// Clean up memory:
+// Clean up memory. The renderer owns the planet's GPU buffer and drops
+// it once the planet has no data.
 void planet::clean()
 {
-    // Delete the planetVBO if it exists:
-    if (GL_TRUE == glIsBuffer(planetVBO))
-    {
-        // This replaces destroyPlanetVBO(...) in draw.hpp:
-        glDeleteBuffers(1, &planetVBO);
-        planetVBO = GL_INVALID_VALUE;
-    }
     // planetData memory no longer needed:
     if (NULL != this->planetData)
     {
         delete [] this->planetData;
         this->planetData = NULL;
     }
+    this->distanceField.clear();
 }
 
 // Set a different planet graphic:
-void planet::changePlanetGraphic(GLfloat nmaxRad)
+void planet::changePlanetGraphic(float nmaxRad)
 {
     this->maxRad = nmaxRad;
     this->mass = this->maxRad*PLANET_MASS;
 
     this->clean();
     this->planetData = createPlanetData(this->maxRad);
-    this->planetVBO = createPlanetVBO(this->planetData);
+    ++this->meshVersion;
+    this->clearEdits();
+    this->distanceField.build(this->planetData);
+    this->updateWorldGeometry();
+}
+
+// --PURPOSE--
+// Rebuild the world-space outline and its normals from pos, orient and
+// the planet data. Collision tests read these instead of rotating the
+// outline themselves, so this must be called whenever any of the three
+// changes; World does it once per tick in updatePlanets().
+void planet::updateWorldGeometry()
+{
+    this->orientCos = cos(this->orient);
+    this->orientSin = sin(this->orient);
+
+    if (NULL == this->planetData)
+    {
+        for (int i = 0; i < 2*NUM_PLANET_VERTS+4; ++i)
+            this->worldData[i] = (i%2) ? this->pos[1] : this->pos[0];
+        for (int i = 0; i < 2*NUM_PLANET_VERTS; ++i)
+            this->edgeNormals[i] = this->spokeNormals[i] = 0.0f;
+        return;
+    }
+
+    for (int i = 0; i < NUM_PLANET_VERTS+2; ++i) this->refreshPoint(i);
+    for (int v = 0; v < NUM_PLANET_VERTS; ++v) this->refreshNormals(v);
+}
+
+// --PURPOSE--
+// Blast a crater into the surface where a bullet landed. Vertices the
+// crater reaches are pulled in along their own direction from the
+// center, to where the crater's edge crosses it, so vertex angles never
+// change and the outline stays a fan. Only the vertices that move, the
+// normals next to them and the part of the distance field they can
+// reach are updated.
+// --PARAMETERS--
+// wpos:    Center of the crater, in world space.
+// rad:     Radius of the crater.
+// --RETURNS--
+// The number of vertices that moved.
+int planet::crater(glm::vec2 wpos, float rad)
+{
+    using glm::vec2;
+    if (NULL == this->planetData) return 0;
+
+    // Into the planet frame with the cached orientation:
+    vec2 p = wpos-this->pos;
+    float c = this->orientCos;
+    float s = this->orientSin;
+    vec2 local = vec2(c*p[0]+s*p[1], c*p[1]-s*p[0]);
+    float len = glm::length(local);
+
+    // Vertices in the angular range the crater covers:
+    float radIncrement = TAU/float(NUM_PLANET_VERTS);
+    float theta = atan2(local[1], local[0]);
+    float alpha = (len > rad) ? asin(rad/len) : PI;
+    int first = int(floor((theta-alpha)/radIncrement));
+    int last = int(ceil((theta+alpha)/radIncrement));
+    if (last-first >= NUM_PLANET_VERTS) last = first+NUM_PLANET_VERTS-1;
+
+    // Bounds of everything that moves, for the distance field:
+    float minRad = CRATER_MIN_SCALE*this->maxRad;
+    vec2 lo = local, hi = local;
+    int moved = 0;
+    unsigned version = this->editVersion+1;
+    for (int i = first; i <= last; ++i)
+    {
+        int v = ((i%NUM_PLANET_VERTS)+NUM_PLANET_VERTS)%NUM_PLANET_VERTS;
+        float* vert = this->planetData+2*v+2;
+        vec2 old = vec2(vert[0], vert[1]);
+        float r = glm::length(old);
+        if (r <= minRad) continue;
+        vec2 dir = old/r;
+
+        // Where the ray from the center through the vertex enters the
+        // crater, if the vertex is past that point but not past the far
+        // side:
+        float b = glm::dot(dir, local);
+        float disc = b*b-(len*len-rad*rad);
+        if (disc < 0.0f) continue;
+        float tNear = b-sqrt(disc);
+        float tFar = b+sqrt(disc);
+        if (r <= tNear || r > tFar) continue;
+        if (tNear < minRad) tNear = minRad;
+
+        vec2 now = tNear*dir;
+        vert[0] = now[0];
+        vert[1] = now[1];
+        this->vertexEdits[v+1] = version;
+        if (0 == v)
+        {
+            // The closing copy of the first vertex:
+            this->planetData[2*NUM_PLANET_VERTS+2] = now[0];
+            this->planetData[2*NUM_PLANET_VERTS+3] = now[1];
+            this->vertexEdits[NUM_PLANET_VERTS+1] = version;
+            this->refreshPoint(NUM_PLANET_VERTS+1);
+        }
+        this->refreshPoint(v+1);
+
+        // The edges on both sides moved too:
+        int prev = (v+NUM_PLANET_VERTS-1)%NUM_PLANET_VERTS;
+        int next = (v+1)%NUM_PLANET_VERTS;
+        const float* pv = this->planetData+2*prev+2;
+        const float* nv = this->planetData+2*next+2;
+        lo = glm::min(lo, glm::min(glm::min(old, now),
+                                   glm::min(vec2(pv[0], pv[1]),
+                                            vec2(nv[0], nv[1]))));
+        hi = glm::max(hi, glm::max(glm::max(old, now),
+                                   glm::max(vec2(pv[0], pv[1]),
+                                            vec2(nv[0], nv[1]))));
+        ++moved;
+    }
+    if (0 == moved) return 0;
+
+    // Normals of the spokes and edges touching a moved vertex:
+    for (int i = first-1; i <= last; ++i)
+    {
+        int v = ((i%NUM_PLANET_VERTS)+NUM_PLANET_VERTS)%NUM_PLANET_VERTS;
+        this->refreshNormals(v);
+    }
+    this->distanceField.patch(this->planetData, lo[0], lo[1], hi[0], hi[1]);
+    this->editVersion = version;
+    return moved;
+}
+
+// --PURPOSE--
+// Whether any vertex changed in a crater after a given edit.
+// --PARAMETERS--
+// slot:    Point in the planet data: 0 is the center, 1 through
+//          NUM_PLANET_VERTS the vertices, then the closing copy.
+// since:   An earlier editVersion.
+bool planet::editedSince(int slot, unsigned since) const
+{
+    return this->vertexEdits[slot] > since;
 }
 
-// Draw call:
-void planet::draw() const
+// The editVersion of the crater that last moved a point, 0 if none has:
+unsigned planet::getEditVersion(int slot) const
 {
-    // Don't draw a planet that doesn't exist:
-    if (GL_FALSE == glIsBuffer(this->planetVBO)) return;
+    return this->vertexEdits[slot];
+}
+
+// Forget the crater history, e.g. when the data is replaced outright:
+void planet::clearEdits()
+{
+    this->editVersion = 0;
+    for (int i = 0; i < NUM_PLANET_VERTS+2; ++i) this->vertexEdits[i] = 0;
+}
+
+// World-space copy of one point of the planet data:
+void planet::refreshPoint(int slot)
+{
+    float x = this->planetData[2*slot];
+    float y = this->planetData[2*slot+1];
+    float c = this->orientCos;
+    float s = this->orientSin;
+    this->worldData[2*slot] = c*x-s*y+this->pos[0];
+    this->worldData[2*slot+1] = s*x+c*y+this->pos[1];
+}
+
+// Normals of spoke v and edge v, from the world-space outline:
+void planet::refreshNormals(int v)
+{
+    using glm::vec2;
 
-    // Convert radians to degrees for drawing:
-    GLfloat deg = (this->orient)*(180.0f/PI);
+    const float *world = this->worldData;
+    vec2 spoke = vec2(world[2*v+2]-world[0], world[2*v+3]-world[1]);
+    vec2 edge = vec2(world[2*v+4]-world[2*v+2],
+                     world[2*v+5]-world[2*v+3]);
+    float sLen = glm::length(spoke);
+    float eLen = glm::length(edge);
+    sLen = (sLen > TOL) ? 1.0f/sLen : 0.0f;
+    eLen = (eLen > TOL) ? 1.0f/eLen : 0.0f;
+    this->spokeNormals[2*v] = -spoke[1]*sLen;
+    this->spokeNormals[2*v+1] = spoke[0]*sLen;
+    this->edgeNormals[2*v] = edge[1]*eLen;
+    this->edgeNormals[2*v+1] = -edge[0]*eLen;
+}
 
-    // We'll have to come up with layer constants later.
-    setDrawLayer(0);
-    setDrawColor(glm::vec4(this->color, 0.5f));
-    drawPlanet(this->planetVBO, this->pos, deg);
+const float* planet::getWorldData() const
+{
+    return this->worldData;
+}
 
-    setDrawLayer(1);
-    setDrawColor(this->color);
-    drawWirePlanet(this->planetVBO, this->pos, deg);
+const float* planet::getEdgeNormals() const
+{
+    return this->edgeNormals;
+}
+
+const float* planet::getSpokeNormals() const
+{
+    return this->spokeNormals;
+}
+
+const DistanceField& planet::getDistanceField() const
+{
+    return this->distanceField;
+}
+
+// Copy the cached world geometry and crater history of another planet:
+void planet::copyWorldGeometry(const planet& other)
+{
+    this->editVersion = other.editVersion;
+    for (int i = 0; i < NUM_PLANET_VERTS+2; ++i)
+        this->vertexEdits[i] = other.vertexEdits[i];
+    this->orientCos = other.orientCos;
+    this->orientSin = other.orientSin;
+    for (int i = 0; i < 2*NUM_PLANET_VERTS+4; ++i)
+        this->worldData[i] = other.worldData[i];
+    for (int i = 0; i < 2*NUM_PLANET_VERTS; ++i)
+    {
+        this->edgeNormals[i] = other.edgeNormals[i];
+        this->spokeNormals[i] = other.spokeNormals[i];
+    }
 }
 
 //-----------------------------//
@@ -130,13 +364,75 @@ bullet::~bullet()
     //fprintf(stdout, "Destructing satellite::bullet: 0x%x...\n", this);
 }
 
-// Draw call:
-void bullet::draw() const
+//-------------------//
+// Planet Generation //
+//-------------------//
+void genRandomFractalMap(float range, int x0, int xn, float *map) 
 {
-    // Don't draw a circle that doesn't exist:
-    if (0.0f >= this->rad) return;    
+    int xm = (xn+x0)/2;
+    float val = range*(float(rand())/RAND_MAX-0.5); 
+    
+    if (xn - x0 <= 5)
+    {
+        for (int i = x0; i < xn; ++i)
+        {
+            map[i] = (map[x0] + map[xn])/2;
+        }
+    }
+    else
+    {   
+        map[xm] = map[xm] + val + (map[x0]+map[xn])/2;
+        genRandomFractalMap(range*0.5f,x0,xm,map);
+        genRandomFractalMap(range*0.5f,xm,xn,map);
+    }   
+}
 
-    setDrawLayer(2);
-    setDrawColor(this->color);
-    drawCircle(this->rad, this->pos);
+float *createPlanetData(float maxRad)
+{
+    float *ranMap = new float[NUM_PLANET_VERTS];
+    for (int i = 0; i < NUM_PLANET_VERTS; ++i) ranMap[i] = 0;
+    genRandomFractalMap(1.0f, 0, NUM_PLANET_VERTS-1, ranMap);
+
+    double theta = 0.0;
+    double radIncrement = 2.0*PI/double(NUM_PLANET_VERTS);
+
+    float *planetData = new float[2*NUM_PLANET_VERTS+4];
+    // Center of planet.
+    planetData[0] = 0.0f;   // x
+    planetData[1] = 0.0f;   // y
+    float maxLen = 0.0f;
+    // The rest of the points along the circumference.
+    for (int i = 0; i < NUM_PLANET_VERTS; ++i)
+    {   
+        // i = NUM_PLANET_VERTS-1
+        // planetData[2*NUM_PLANET_VERTS]
+        // planetData[2*NUM_PLANET_VERTS+1]
+
+           //planetData[2*i+2] = cos(theta); // x
+        //planetData[2*i+3] = sin(theta); // y
+
+           planetData[2*i+2] = cos(theta)*(1+ranMap[i]); // x
+        planetData[2*i+3] = sin(theta)*(1+ranMap[i]); // y
+        theta += radIncrement;
+
+        // Find the length of this vector:
+        using glm::distance;
+        using glm::vec2;
+        float len =  distance(vec2(planetData[2*i+2], planetData[2*i+3]), vec2(0.0f));
+        if (len > maxLen) maxLen = len; 
+    }       
+
+    for (int i = 1; i <= NUM_PLANET_VERTS; ++i)
+    {   
+        planetData[2*i] *= (maxRad/maxLen);
+        planetData[2*i+1] *= (maxRad/maxLen);
+    }
+    
+    // Complete the circle.
+    planetData[2*NUM_PLANET_VERTS+2] = planetData[2]; // x
+    planetData[2*NUM_PLANET_VERTS+3] = planetData[3]; // y
+    
+    delete [] ranMap;
+    return planetData;
+    
 }
@@ -2,9 +2,8 @@
 #ifndef SATELLITE_HPP_
 #define SATELLITE_HPP_
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 #include "constants.hpp"
-#include "draw.hpp"
+#include "DistanceField.hpp"
 #include <cstdio>
 
 //------------//
@@ -15,10 +14,9 @@ class satellite
 public:
     satellite() {/*Does nothing*/}
     virtual ~satellite() {/*Does nothing*/}
-    virtual void draw() const {/*Does nothing*/}
 
     // Attributes:
-    GLfloat mass;
+    float mass;
     glm::vec2 pos;
     glm::vec2 vel;
     glm::vec3 color;
@@ -32,21 +30,50 @@ class planet : public satellite
 {
 public:
     planet();
-    planet(GLfloat imaxRad, glm::vec2 ipos);
+    planet(float imaxRad, glm::vec2 ipos);
+    planet(const planet& other);
     ~planet();
+    planet& operator=(const planet& other);
     void clean();
-    GLfloat* getPlanetData() const;
-    void changePlanetGraphic(GLfloat nmaxRad);
-    void draw() const;
+    float* getPlanetData() const;
+    void changePlanetGraphic(float nmaxRad);
+    void updateWorldGeometry();
+    int crater(glm::vec2 wpos, float rad);
+    bool editedSince(int slot, unsigned since) const;
+    unsigned getEditVersion(int slot) const;
+    const float* getWorldData() const;
+    const float* getEdgeNormals() const;
+    const float* getSpokeNormals() const;
+    const DistanceField& getDistanceField() const;
 
     // Public attributes:
-    GLfloat orient;      // rotation about z-axis
-    GLfloat rotSpeed; // rotation speed
-    GLfloat maxRad;   // maximum radius from center
+    float orient;      // rotation about z-axis
+    float rotSpeed; // rotation speed in radians per second
+    float maxRad;   // maximum radius from center
+    unsigned meshVersion;   // bumped whenever the planet data is replaced
+    unsigned editVersion;   // bumped by every crater, 0 for fresh data
+
+    // Orientation the world geometry was last built for:
+    float orientCos;
+    float orientSin;
 private:
+    void copyWorldGeometry(const planet& other);
+    void clearEdits();
+    void refreshPoint(int slot);
+    void refreshNormals(int v);
+
     // Private attributes:
-    GLuint planetVBO;
-    GLfloat *planetData;
+    float *planetData;
+    DistanceField distanceField;    // baked from planetData
+    unsigned vertexEdits[NUM_PLANET_VERTS+2];   // editVersion of each point's last move
+
+    // planetData rotated by orient and moved to pos, laid out the same
+    // way, with unit normals of the outline edges (vertex i to i+1) and
+    // of the spokes (center to vertex i). Only as fresh as the last
+    // updateWorldGeometry():
+    float worldData[2*NUM_PLANET_VERTS+4];
+    float edgeNormals[2*NUM_PLANET_VERTS];
+    float spokeNormals[2*NUM_PLANET_VERTS];
 };
 
 //--------------//
@@ -58,14 +85,19 @@ public:
     bullet();
     bullet(glm::vec2 ipos, glm::vec2 ivel);
     ~bullet();
-    void draw() const;
 
     // Attributes:
-    GLfloat rad;
-    GLfloat startTime;
+    float rad;
+    float startTime;
     bool onPlanet;
 private:
 
 };
 
+//-------------------//
+// Planet Generation //
+//-------------------//
+float *createPlanetData(float maxRad);
+void genRandomFractalMap(float range, int x0, int xn, float *map);
+
 #endif